@@ -0,0 +1,50 @@
+#ifndef BENCH_HPP
+# define BENCH_HPP
+
+#include <ctime>
+#include <stdint.h>
+
+/**
+ * @brief Helpers shared by the benchmark drivers in `bench/`, built and run by `make bench`.
+ *
+ * The drivers link the server's objects as they are built for `webserv`, with the same flags.
+ */
+namespace Bench {
+	/**
+	 * @return The thread's CPU time in nanoseconds.
+	 */
+	inline uint64_t cpuTime() {
+		struct timespec now;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+	}
+
+	/**
+	 * @brief A xorshift generator, every run of a driver sees the same sequence.
+	 */
+	class Random {
+		private:
+			uint64_t state;
+		public:
+			Random() : state(88172645463325252ULL) {};
+			uint64_t next() {
+				this->state ^= this->state << 13;
+				this->state ^= this->state >> 7;
+				this->state ^= this->state << 17;
+				return this->state;
+			}
+			size_t below(size_t bound) {
+				return next() % bound;
+			}
+	};
+
+	/**
+	 * @brief Keeps the compiler from dropping a result that is otherwise unused.
+	 */
+	inline void keep(uint64_t value) {
+		static volatile uint64_t sink;
+		sink = sink + value;
+	}
+}
+
+#endif
\ No newline at end of file
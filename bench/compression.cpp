@@ -0,0 +1,162 @@
+#include "Bench.hpp"
+#include "Compression.hpp"
+#include "Logger.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Every file is compressed until about this many bytes went through zlib, and at least `MIN_ROUNDS` times
+# define BYTES_PER_CASE 4194304
+# define MIN_ROUNDS 20
+// Entries of the generated directory listing
+# define LISTING_ENTRIES 400
+
+// Assets of the tree and an image, which is not in `gzip_types`; `make bench` runs from the root
+static const char* const assets[] = {"www/index.html", "www/styles.css", "www/pages/cgi.html", "www/images/image1.jpg"};
+
+struct Result {
+	size_t bytesIn;
+	size_t bytesOut;
+	// CPU time of one compression in nanoseconds
+	double memory;
+	double file;
+	Result() : bytesIn(0), bytesOut(0), memory(0), file(0) {};
+};
+
+/**
+ * @brief Compresses one file with `compress()` and with `compressFile()`, the cache is off so every call compresses.
+ */
+static bool run(Compression& compression, const char* path, ContentEncoding encoding, Result& result) {
+	std::ifstream input(path, std::ios::binary);
+	std::ostringstream content;
+	content << input.rdbuf();
+	std::string data = content.str();
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	if (!input || fd == -1 || fstat(fd, &info) == -1) {
+		std::printf("compression cannot read %s, run it from the root of the tree\n", path);
+		if (fd != -1)
+			close(fd);
+		return false;
+	}
+	size_t rounds = std::max(static_cast<size_t>(MIN_ROUNDS), BYTES_PER_CASE / std::max(data.size(), static_cast<size_t>(1)));
+	std::string out;
+	uint64_t start = Bench::cpuTime();
+	for (size_t i = 0; i < rounds; i++)
+		compression.compress(data, encoding, out);
+	result.memory = static_cast<double>(Bench::cpuTime() - start) / rounds;
+	start = Bench::cpuTime();
+	for (size_t i = 0; i < rounds; i++) {
+		SharedBuffer* compressed = compression.compressFile(path, fd, info, encoding);
+		if (compressed)
+			compressed->release();
+	}
+	result.file = static_cast<double>(Bench::cpuTime() - start) / rounds;
+	close(fd);
+	result.bytesIn = data.size();
+	result.bytesOut = out.size();
+	return true;
+}
+
+/**
+ * @brief Writes a directory listing like the autoindex pages, the same for every run, to a temporary file.
+ * @return The path of the file, empty if it could not be written.
+ */
+static std::string writeListing() {
+	char path[] = "/tmp/webserv_bench_listing_XXXXXX";
+	int fd = mkstemp(path);
+	if (fd == -1)
+		return "";
+	std::ostringstream html;
+	html << "<!DOCTYPE html>\n<html>\n<head><title>Index of /uploads/</title></head>\n<body>\n<h1>Index of /uploads/</h1>\n<ul>\n";
+	Bench::Random random;
+	for (size_t i = 0; i < LISTING_ENTRIES; i++) {
+		std::ostringstream name;
+		name << "upload_" << random.below(100000) << (i % 3 ? ".txt" : ".png");
+		html << "<li><a href=\"/uploads/" << name.str() << "\">" << name.str() << "</a> " << random.below(1048576)
+			<< " bytes</li>\n";
+	}
+	html << "</ul>\n</body>\n</html>\n";
+	std::string data = html.str();
+	bool written = write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+	close(fd);
+	if (!written) {
+		unlink(path);
+		return "";
+	}
+	return path;
+}
+
+static double saved(size_t bytesIn, size_t bytesOut) {
+	return bytesIn ? 100.0 * (static_cast<double>(bytesIn) - static_cast<double>(bytesOut)) / bytesIn : 0;
+}
+
+int main() {
+	Logger::initialize(false);
+	std::string listing = writeListing();
+	if (listing.empty()) {
+		std::printf("compression cannot write the directory listing\n");
+		return 1;
+	}
+	std::vector<std::string> files(assets, assets + sizeof(assets) / sizeof(assets[0]));
+	files.insert(files.end() - 1, listing);
+	bool failed = false;
+	const ContentEncoding encodings[] = {ENCODING_GZIP, ENCODING_DEFLATE};
+	const int levels[] = {1, 6, 9};
+	for (size_t i = 0; i < sizeof(encodings) / sizeof(encodings[0]); i++) {
+		for (size_t j = 0; j < sizeof(levels) / sizeof(levels[0]); j++) {
+			GzipConfig config;
+			config.minLength = 0;
+			config.level = levels[j];
+			config.cacheSize = 0;
+			Compression compression(config);
+			Result total;
+			for (size_t k = 0; k < files.size() && !failed; k++) {
+				Result result;
+				failed = !run(compression, files[k].c_str(), encodings[i], result);
+				const char* name = files[k] == listing ? "directory listing" : files[k].c_str();
+				std::printf("compression %-7s level %d %-22s %8zu -> %8zu bytes %5.1f%% saved  compress %8.1f us  compressFile %8.1f us\n",
+					Compression::encodingName(encodings[i]), levels[j], name, result.bytesIn, result.bytesOut,
+					saved(result.bytesIn, result.bytesOut), result.memory / 1000, result.file / 1000);
+				// The image is only there to show what compressing it would cost
+				if (k + 1 == files.size())
+					continue;
+				total.bytesIn += result.bytesIn;
+				total.bytesOut += result.bytesOut;
+				total.file += result.file;
+			}
+			if (failed)
+				break;
+			std::printf("compression %-7s level %d %-22s %8zu -> %8zu bytes %5.1f%% saved  %.2f us CPU per KiB saved\n",
+				Compression::encodingName(encodings[i]), levels[j], "text files", total.bytesIn, total.bytesOut,
+				saved(total.bytesIn, total.bytesOut), total.file / 1000 / ((total.bytesIn - total.bytesOut) / 1024.0));
+		}
+	}
+	unlink(listing.c_str());
+	if (failed)
+		return 1;
+	// What a cached variant costs instead, the usual case for a static file
+	GzipConfig config;
+	config.minLength = 0;
+	config.level = 6;
+	config.cacheSize = 8388608;
+	Compression compression(config);
+	int fd = open(assets[0], O_RDONLY);
+	struct stat info;
+	if (fd == -1 || fstat(fd, &info) == -1)
+		return 1;
+	compression.compressFile(assets[0], fd, info, ENCODING_GZIP)->release();
+	uint64_t start = Bench::cpuTime();
+	for (size_t i = 0; i < 1000000; i++)
+		compression.lookup(assets[0], ENCODING_GZIP, info)->release();
+	std::printf("compression gzip    level 6 %-22s cached variant %.0f ns\n", assets[0], static_cast<double>(Bench::cpuTime() - start) / 1000000);
+	close(fd);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "Bench.hpp"
+#include "ConnectionTable.hpp"
+#include "Logger.hpp"
+
+#include <map>
+#include <vector>
+#include <cstdio>
+
+// Close/accept cycles per table size, each followed by the lookups of one event
+# define CYCLES 200000
+# define LOOKUPS_PER_EVENT 12
+// The descriptors below belong to the listening sockets, the poller and the standard streams
+# define FIRST_CLIENT_FD 8
+
+/**
+ * @brief The client states in a `std::map`, as `SocketManager` kept them before `ConnectionTable`.
+ *
+ * `ClientState` can no longer be copied, so the map holds pointers; that is one more allocation
+ * per accept than the old map had.
+ */
+class MapTable {
+	private:
+		std::map<int, ClientState*> states;
+	public:
+		~MapTable() {
+			for (std::map<int, ClientState*>::iterator it = this->states.begin(); it != this->states.end(); ++it)
+				delete it->second;
+		}
+		void insert(int fd) {
+			this->states[fd] = new ClientState();
+		}
+		ClientState* find(int fd) {
+			std::map<int, ClientState*>::iterator it = this->states.find(fd);
+			return it == this->states.end() ? NULL : it->second;
+		}
+		void erase(int fd) {
+			std::map<int, ClientState*>::iterator it = this->states.find(fd);
+			delete it->second;
+			this->states.erase(it);
+		}
+		// The timeout check visits every client
+		uint64_t sweep() {
+			uint64_t total = 0;
+			for (std::map<int, ClientState*>::iterator it = this->states.begin(); it != this->states.end(); ++it)
+				total += it->second->lastActivity;
+			return total;
+		}
+};
+
+class SlotTable {
+	private:
+		ConnectionTable states;
+	public:
+		void insert(int fd) {
+			this->states.insert(fd);
+		}
+		ClientState* find(int fd) {
+			return this->states.find(fd);
+		}
+		void erase(int fd) {
+			this->states.erase(fd);
+		}
+		uint64_t sweep() {
+			uint64_t total = 0;
+			for (size_t i = 0; i < this->states.size(); i++)
+				total += this->states.find(this->states.fdAt(i))->lastActivity;
+			return total;
+		}
+};
+
+/**
+ * @brief Closes a random client and accepts a new one, which gets the lowest free descriptor
+ * from the kernel, the one that was just closed. Every accept is followed by the lookups of an event.
+ */
+template <typename Table>
+void run(const char* name, size_t clients) {
+	Table table;
+	for (size_t i = 0; i < clients; i++)
+		table.insert(FIRST_CLIENT_FD + i);
+	Bench::Random random;
+	uint64_t start = Bench::cpuTime();
+	for (size_t i = 0; i < CYCLES; i++) {
+		int fd = FIRST_CLIENT_FD + random.below(clients);
+		table.erase(fd);
+		table.insert(fd);
+	}
+	uint64_t cycles = Bench::cpuTime() - start;
+	start = Bench::cpuTime();
+	for (size_t i = 0; i < CYCLES * LOOKUPS_PER_EVENT; i++)
+		Bench::keep(table.find(FIRST_CLIENT_FD + random.below(clients))->lastActivity);
+	uint64_t lookups = Bench::cpuTime() - start;
+	start = Bench::cpuTime();
+	for (size_t i = 0; i < 100; i++)
+		Bench::keep(table.sweep());
+	uint64_t sweeps = Bench::cpuTime() - start;
+	std::printf("connections %6zu clients %-15s %7.0f ns/close+accept %6.1f ns/lookup %8.1f us/sweep\n", clients, name,
+		static_cast<double>(cycles) / CYCLES, static_cast<double>(lookups) / (CYCLES * LOOKUPS_PER_EVENT),
+		static_cast<double>(sweeps) / 100 / 1000);
+}
+
+int main() {
+	Logger::initialize(false);
+	const size_t sizes[] = {100, 1000, 10000, 50000};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		run<MapTable>("std::map", sizes[i]);
+		run<SlotTable>("ConnectionTable", sizes[i]);
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "Bench.hpp"
+#include "RequestParser.hpp"
+#include "HTTPRequest.hpp"
+#include "Logger.hpp"
+#include "Utils.hpp"
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+// Requests parsed per case
+# define REQUESTS 50000
+
+/**
+ * @brief The request handling before `RequestParser`: `SocketManager::parseClientData()` searched the whole
+ * buffer for the end of the headers after every read, then for `Content-Length` and `Host`, and
+ * `HTTPRequest::parseRequest()` parsed the complete request again with streams into a map.
+ */
+class OldRequest {
+	private:
+		bool headersComplete;
+		size_t headerEndIndex;
+		size_t contentLength;
+		std::string method;
+		std::string uri;
+		std::string version;
+		std::map<std::string, std::string> headers;
+		std::string body;
+
+		void parseRequest(const std::string& request) {
+			std::istringstream requestStream(request);
+			std::string line;
+			std::getline(requestStream, line);
+			std::istringstream lineStream(line);
+			lineStream >> this->method;
+			lineStream >> this->uri;
+			lineStream >> this->version;
+			while (std::getline(requestStream, line) && line != "\r") {
+				size_t colonPos = line.find(":");
+				if (colonPos != std::string::npos) {
+					std::string key = line.substr(0, colonPos);
+					std::string value = trim(line.substr(colonPos + 1));
+					this->headers[key] = value;
+				}
+			}
+			std::string length = this->headers["Content-Length"];
+			if (!length.empty()) {
+				this->body.resize(std::atoi(length.c_str()));
+				requestStream.read(&this->body[0], this->body.size());
+			}
+			SUCCESS("Recived HTTP Request: " << method << " on " << uri);
+		}
+	public:
+		OldRequest() : headersComplete(false), headerEndIndex(0), contentLength(0) {};
+
+		// Called after every read, true once the request was parsed
+		bool parse(const std::string& buffer) {
+			if (!this->headersComplete) {
+				size_t headerEndPos = buffer.find("\r\n\r\n");
+				if (headerEndPos == std::string::npos)
+					return false;
+				this->headersComplete = true;
+				this->headerEndIndex = headerEndPos + 4;
+				size_t startPos = buffer.find("Content-Length: ");
+				this->contentLength = 0;
+				if (startPos != std::string::npos) {
+					startPos += 16;
+					std::istringstream iss(buffer.substr(startPos, buffer.find("\r\n", startPos) - startPos));
+					iss >> this->contentLength;
+				}
+				startPos = buffer.find("Host: ");
+				std::string hostName;
+				if (startPos != std::string::npos) {
+					startPos += 6;
+					std::istringstream iss(buffer.substr(startPos, buffer.find("\r\n", startPos) - startPos));
+					iss >> hostName;
+				}
+				Bench::keep(hostName.size());
+			}
+			if (buffer.size() - this->headerEndIndex < this->contentLength)
+				return false;
+			parseRequest(buffer);
+			return true;
+		}
+};
+
+/**
+ * @brief The current path: `RequestParser` continues on every read, `SocketManager::parseClientData()`
+ * looks `Host` up once the headers are complete and `HTTPRequest` takes the body.
+ */
+static bool parseNew(std::string& buffer, RequestParser& parser) {
+	bool hadHeaders = parser.headersComplete();
+	ParseState state = parser.parse(buffer);
+	if (!hadHeaders && parser.headersComplete()) {
+		Bench::keep(parser.getHeader(buffer, "Host").size());
+		parser.setBodyLimit(1048576);
+		state = parser.parse(buffer);
+	}
+	if (state != PARSE_COMPLETE)
+		return false;
+	HTTPRequest request(buffer, parser);
+	Bench::keep(request.getBody().size());
+	return true;
+}
+
+// Recorded from curl, Firefox and a form submitted by Chrome
+static const char* const requests[] = {
+	"GET / HTTP/1.1\r\n"
+	"Host: localhost:8080\r\n"
+	"User-Agent: curl/8.5.0\r\n"
+	"Accept: */*\r\n"
+	"\r\n",
+
+	"GET /styles.css HTTP/1.1\r\n"
+	"Host: localhost:8080\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+	"Accept: text/css,*/*;q=0.1\r\n"
+	"Accept-Language: en-US,en;q=0.5\r\n"
+	"Accept-Encoding: gzip, deflate, br\r\n"
+	"Connection: keep-alive\r\n"
+	"Referer: http://localhost:8080/\r\n"
+	"Cookie: session=4f6b1c2a9e8d7f3b; theme=dark; _ga=GA1.1.1234567890.1712345678\r\n"
+	"Sec-Fetch-Dest: style\r\n"
+	"Sec-Fetch-Mode: no-cors\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"If-Modified-Since: Tue, 16 Apr 2024 10:12:44 GMT\r\n"
+	"If-None-Match: \"66e3f1a0-1b2c\"\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"\r\n",
+
+	"POST /cgi/form.py HTTP/1.1\r\n"
+	"Host: localhost:8080\r\n"
+	"Connection: keep-alive\r\n"
+	"Content-Length: 42\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"sec-ch-ua-platform: \"Linux\"\r\n"
+	"Origin: http://localhost:8080\r\n"
+	"Content-Type: application/x-www-form-urlencoded\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+	"Referer: http://localhost:8080/form.html\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Accept-Language: en-GB,en;q=0.9,de;q=0.8\r\n"
+	"\r\n"
+	"name=Conrad&message=Hello+from+the+bench%21",
+};
+static const char* const names[] = {"curl GET", "Firefox GET", "Chrome POST"};
+
+/**
+ * @brief The old path, a fresh request for every request.
+ */
+struct OldPath {
+	OldRequest request;
+	void reset() {
+		this->request = OldRequest();
+	}
+	bool operator()(std::string& buffer) {
+		return this->request.parse(buffer);
+	}
+};
+
+/**
+ * @brief The current path, the parser is reset for every request, like on a keep-alive connection.
+ */
+struct NewPath {
+	RequestParser parser;
+	void reset() {
+		this->parser.reset();
+	}
+	bool operator()(std::string& buffer) {
+		return parseNew(buffer, this->parser);
+	}
+};
+
+/**
+ * @brief Feeds every request in reads of `segment` bytes, the whole request at once for 0.
+ * @return CPU time per request in nanoseconds.
+ */
+template <typename Path>
+double run(const std::string& request, size_t segment) {
+	Path path;
+	size_t step = segment ? segment : request.size();
+	uint64_t start = Bench::cpuTime();
+	for (size_t i = 0; i < REQUESTS; i++) {
+		path.reset();
+		std::string buffer;
+		for (size_t offset = 0; offset < request.size(); offset += step) {
+			buffer.append(request, offset, step);
+			if (path(buffer))
+				break;
+		}
+	}
+	return static_cast<double>(Bench::cpuTime() - start) / REQUESTS;
+}
+
+int main() {
+	Logger::initialize(false);
+	const size_t segments[] = {0, 64, 1};
+	const char* const reads[] = {"one read", "64 B reads", "1 B reads"};
+	for (size_t i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+		std::string request(requests[i]);
+		for (size_t j = 0; j < sizeof(segments) / sizeof(segments[0]); j++) {
+			double oldTime = run<OldPath>(request, segments[j]);
+			double newTime = run<NewPath>(request, segments[j]);
+			std::printf("parser %-12s %4zu bytes in %-10s HTTPRequest %7.0f ns  RequestParser %7.0f ns  %5.1fx\n",
+				names[i], request.size(), reads[j], oldTime, newTime, oldTime / newTime);
+		}
+	}
+	return 0;
+}
\ No newline at end of file
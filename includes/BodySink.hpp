@@ -0,0 +1,21 @@
+#ifndef BODY_SINK_HPP
+# define BODY_SINK_HPP
+
+#include <cstddef>
+
+/**
+ * @brief Receives a request body while it arrives instead of it being kept in the read buffer.
+ *
+ * See `RequestParser::setBodySink()`. For a chunked body the decoded payload is passed on.
+ */
+class BodySink {
+	public:
+		virtual ~BodySink() {};
+
+		/**
+		 * @brief Receives the next piece of the body. A sink that fails keeps accepting and discards the rest.
+		 */
+		virtual void write(const char* data, size_t length) = 0;
+};
+
+#endif
\ No newline at end of file
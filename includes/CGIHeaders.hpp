@@ -0,0 +1,69 @@
+#ifndef CGI_HEADERS_HPP
+# define CGI_HEADERS_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// Output that has no complete header block after this many bytes is taken as a body without headers
+# define CGI_HEADER_LIMIT 8192
+
+enum CGIHeaderState {
+	CGI_HEADERS_PENDING,
+	CGI_HEADERS_COMPLETE,
+	// The script printed its body right away
+	CGI_HEADERS_NONE,
+	CGI_HEADERS_INVALID,
+};
+
+/**
+ * @brief Parses the header block a CGI script writes in front of its body (RFC 3875, section 6.3).
+ *
+ * `Status` sets the status code and `Location` without `Status` means 302. The other fields are passed on,
+ * except for the framing (`Content-Length`, `Transfer-Encoding`, `Connection`) that the server sets itself.
+ * Scripts that print their body right away, like the ones in `www/cgi`, are recognised by a first line
+ * that is not a header field.
+ */
+class CGIHeaders {
+	private:
+		CGIHeaderState state;
+		int statusCode;
+		std::vector<std::pair<std::string, std::string> > fields;
+		size_t bodyOffset;
+
+		/**
+		 * @brief Applies `Status` and `Location` and drops the framing fields once the block is complete.
+		 */
+		void finish();
+		static bool parseField(const std::string& line, std::string& name, std::string& value);
+		static bool equalsIgnoreCase(const std::string& a, const char* b);
+	public:
+		CGIHeaders();
+		~CGIHeaders();
+
+		/**
+		 * @brief Prepares the parser for the output of the next script.
+		 */
+		void reset();
+
+		/**
+		 * @brief Looks for the end of the header block in the output read so far.
+		 *
+		 * @param output Everything the script wrote so far.
+		 * @param finished True once the script closed its output, an unterminated block is then taken as body.
+		 * @return `CGI_HEADERS_PENDING` until the block or the first line of a body without headers is complete.
+		 */
+		CGIHeaderState parse(const std::string& output, bool finished);
+
+		CGIHeaderState getState() const;
+		int getStatusCode() const;
+		const std::vector<std::pair<std::string, std::string> >& getFields() const;
+
+		/**
+		 * @return The position in the output where the body starts.
+		 */
+		size_t getBodyOffset() const;
+};
+
+#endif
\ No newline at end of file
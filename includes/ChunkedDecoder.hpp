@@ -0,0 +1,90 @@
+#ifndef CHUNKED_DECODER_HPP
+# define CHUNKED_DECODER_HPP
+
+#include <string>
+#include <cstddef>
+
+// Upper limit for a chunk size line including extensions, and for a single trailer line
+# define CHUNK_LINE_LIMIT 4096
+
+enum ChunkState {
+	CHUNK_SIZE,
+	CHUNK_EXTENSION,
+	CHUNK_SIZE_LF,
+	CHUNK_DATA,
+	CHUNK_DATA_CR,
+	CHUNK_DATA_LF,
+	CHUNK_TRAILER,
+	CHUNK_DONE,
+	CHUNK_ERROR,
+};
+
+/**
+ * @brief Incremental decoder for the chunked transfer coding (RFC 9112, section 7.1).
+ *
+ * `decode()` accepts the body in arbitrary pieces, as they come off the socket, and appends the payload
+ * of each chunk to the output as soon as its bytes arrived. Chunk extensions and trailer fields are
+ * skipped. The decoded size is checked against the body limit while decoding, so an oversized upload
+ * is refused before it was received completely.
+ */
+class ChunkedDecoder {
+	private:
+		ChunkState state;
+		size_t chunkRemaining;
+		size_t sizeDigits;
+		size_t lineLength;
+		bool trailerCR;
+		size_t decodedLength;
+		size_t maxBodySize;
+		int errorStatus;
+
+		/**
+		 * @brief Consumes one byte of the framing around the chunk data.
+		 */
+		void consumeFraming(char c);
+		void startChunkSize();
+		void fail(int status);
+	public:
+		ChunkedDecoder();
+		~ChunkedDecoder();
+
+		/**
+		 * @brief Prepares the decoder for the next body.
+		 *
+		 * @param maxBodySize The largest decoded body that is accepted, larger ones fail with 413.
+		 */
+		void reset(size_t maxBodySize);
+
+		/**
+		 * @brief Decodes the next piece of the body.
+		 *
+		 * @param data The bytes received after the ones passed to the previous call.
+		 * @param length The number of bytes.
+		 * @param output The decoded payload is appended here.
+		 * @return The number of bytes consumed. Decoding stops after the last chunk and its trailer
+		 * section, any bytes behind it belong to the next request.
+		 */
+		size_t decode(const char* data, size_t length, std::string& output);
+
+		/**
+		 * @return True once the last chunk and the trailer section were decoded.
+		 */
+		bool done() const;
+
+		/**
+		 * @return True if the body is malformed or too large, see `getErrorStatus()`.
+		 */
+		bool failed() const;
+
+		/**
+		 * @return The status code to answer a failed body with (400 or 413).
+		 */
+		int getErrorStatus() const;
+
+		/**
+		 * @return The number of payload bytes decoded so far.
+		 */
+		size_t getDecodedLength() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef COMPRESSION_HPP
+# define COMPRESSION_HPP
+
+#include <map>
+#include <list>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "Structs.hpp"
+#include "SharedBuffer.hpp"
+
+// Bigger files are sent uncompressed with sendfile(), compressing them would hold the result in memory
+# define GZIP_MAX_FILE 4194304
+
+/**
+ * @brief Compresses responses with gzip or deflate (zlib) and caches the compressed variants of static files.
+ *
+ * Files are read and compressed in blocks, so only the compressed result is held in memory. A cached variant
+ * is used while the file's device, inode, size and modification time are unchanged, so every file is compressed
+ * once per change. The cache is bounded by `gzip_cache_size` and drops the least recently used variants.
+ * Every event loop has its own instance, it is not thread safe.
+ */
+class Compression {
+	private:
+		struct Entry {
+			dev_t device;
+			ino_t inode;
+			off_t size;
+			struct timespec modified;
+			SharedBuffer* data;
+			std::list<std::string>::iterator recent;
+		};
+
+		const GzipConfig& config;
+		std::map<std::string, Entry> entries;
+		// Keys from the most to the least recently used
+		std::list<std::string> recent;
+		size_t usedSize;
+		size_t hits;
+		size_t misses;
+		// Totals of everything compressed, to weigh the CPU time against the bytes saved
+		size_t bytesIn;
+		size_t bytesOut;
+		double seconds;
+
+		bool begin(z_stream& stream, ContentEncoding encoding) const;
+		bool deflateInto(z_stream& stream, const char* data, size_t length, bool finish, std::string& out);
+		void drop(std::map<std::string, Entry>::iterator it);
+		static std::string makeKey(const std::string& path, ContentEncoding encoding);
+
+		Compression(const Compression&);
+		Compression& operator=(const Compression&);
+	public:
+		/**
+		 * @param config The `gzip_*` settings, have to outlive the instance.
+		 */
+		Compression(const GzipConfig& config);
+		~Compression();
+
+		/**
+		 * @brief Picks the encoding from an `Accept-Encoding` header, gzip before deflate at the same quality.
+		 *
+		 * @return The encoding, `ENCODING_IDENTITY` if the client accepts neither.
+		 */
+		static ContentEncoding negotiate(const std::string& acceptEncoding);
+
+		/**
+		 * @return The `Content-Encoding` value of `encoding`.
+		 */
+		static const char* encodingName(ContentEncoding encoding);
+
+		/**
+		 * @return True if `contentType` is one of `gzip_types`, parameters like "; charset=utf-8" are ignored.
+		 */
+		bool isCompressibleType(const std::string& contentType) const;
+
+		/**
+		 * @return True if a body of `length` bytes is worth compressing.
+		 */
+		bool isCompressibleLength(size_t length) const;
+
+		/**
+		 * @brief Compresses an in-memory body.
+		 *
+		 * @return False if zlib failed, `out` is undefined then.
+		 */
+		bool compress(const std::string& data, ContentEncoding encoding, std::string& out);
+
+		/**
+		 * @return The cached variant of the file at `path` described by `info`, with a reference for the caller,
+		 * or NULL if it is not cached or the file changed since.
+		 */
+		SharedBuffer* lookup(const std::string& path, ContentEncoding encoding, const struct stat& info);
+
+		/**
+		 * @brief Compresses the open file `fd`, described by `info`, and caches the result for `path`.
+		 *
+		 * @return The compressed file with a reference for the caller, or NULL if it could not be read.
+		 */
+		SharedBuffer* compressFile(const std::string& path, int fd, const struct stat& info, ContentEncoding encoding);
+
+		size_t getHits() const;
+		size_t getMisses() const;
+		size_t getBytesIn() const;
+		size_t getBytesOut() const;
+		double getSeconds() const;
+};
+
+#endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Structs.hpp"
 #include "Utils.hpp"
+#include "Poller.hpp"
 
 #include <string>
 #include <stdexcept>
@@ -12,6 +13,11 @@
 #include <stack>
 #include <limits>
 #include <algorithm>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// The open file caches of all event loops together hold at most this share (1/n) of the descriptor limit
+# define OPEN_FILE_CACHE_SHARE 4
 
 class ConfigManager {
 	private:
@@ -45,6 +51,18 @@ class ConfigManager {
 		 *         or the section is incorrectly formatted.
 		 */
 		void parseServerSection(std::ifstream& configFile, std::string& line, ServerConfig& serverConfig);
+
+		/**
+		 * @brief Parses a `types {}` block within the HTTP section.
+		 * 
+		 * Every line maps a MIME type to one or more file extensions, e.g. `audio/mpeg mp3`. The mappings are
+		 * added to the built-in ones and replace them for the same extension.
+		 * 
+		 * @param configFile A reference to the ifstream of the configuration file.
+		 * @param line A string reference to the current line being processed.
+		 * @throws `std::runtime_error` If a line has no extensions or the block is not closed.
+		 */
+		void parseTypesSection(std::ifstream& configFile, std::string& line);
 		
 		/**
 		 * @brief Processes a single server directive found within a server block.
@@ -84,6 +102,16 @@ class ConfigManager {
 		 */
 		void checkLocationPath(std::string& line, LocationConfig& locConfig);
 
+		/**
+		 * @brief Parses the value of an on/off directive like `gzip`.
+		 * 
+		 * @param key The directive, for the error message.
+		 * @param value Either "on" or "off".
+		 * @return True for "on".
+		 * @throws `std::runtime_error` If the value is neither.
+		 */
+		static bool parseSwitch(const std::string& key, const std::string& value);
+
 		/**
 		 * @brief Initializes server configuration with default values.
 		 * 
@@ -112,7 +140,10 @@ class ConfigManager {
 		 * 
 		 * This method checks for essential HTTP configuration settings, ensuring that all required
 		 * directives have been provided and are correctly formatted. Specifically, it verifies that
-		 * a server timeout has been set and that at least one server block exists.
+		 * a server timeout has been set, that at least one server block exists and that
+		 * worker threads and worker processes are not both enabled. Every event loop has its own
+		 * `open_file_cache` holding a descriptor per entry, so the size is lowered until all of them
+		 * fit in `1 / OPEN_FILE_CACHE_SHARE` of `RLIMIT_NOFILE`.
 		 * 
 		 * @throws `std::runtime_error` If the configuration is invalid or incomplete.
 		 */
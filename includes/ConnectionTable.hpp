@@ -0,0 +1,68 @@
+#ifndef CONNECTION_TABLE_HPP
+# define CONNECTION_TABLE_HPP
+
+#include <vector>
+#include <cstddef>
+
+#include "Structs.hpp"
+
+/**
+ * @brief The client states of one event loop, indexed directly by file descriptor.
+ *
+ * The kernel hands out the lowest free file descriptor, so the table stays dense and
+ * lookups, inserts and erases are constant time. The open connections are also kept
+ * in a packed list (swap-remove on erase) so sweeps only visit live connections.
+ */
+class ConnectionTable {
+	private:
+		struct Slot {
+			ClientState* state;
+			size_t position;
+			Slot() : state(NULL), position(0) {};
+		};
+
+		std::vector<Slot> slots;
+		std::vector<int> active;
+
+		ConnectionTable(const ConnectionTable&);
+		ConnectionTable& operator=(const ConnectionTable&);
+	public:
+		ConnectionTable();
+		~ConnectionTable();
+
+		/**
+		 * @brief Creates a fresh client state for the given file descriptor, replacing any existing one.
+		 * @return The new client state.
+		 */
+		ClientState& insert(int fd);
+
+		/**
+		 * @return The client state of the given file descriptor, or NULL if it is not a client.
+		 */
+		ClientState* find(int fd) const;
+
+		/**
+		 * @brief Like `std::map::operator[]`, creates the client state if it does not exist yet.
+		 */
+		ClientState& operator[](int fd);
+
+		/**
+		 * @brief Destroys the client state of the given file descriptor, if there is one.
+		 */
+		void erase(int fd);
+
+		/**
+		 * @return The number of clients.
+		 */
+		size_t size() const;
+		bool empty() const;
+
+		/**
+		 * @brief Iterates the clients in no particular order. Erasing moves the last client into the freed position.
+		 * @param index A position between 0 and `size()`.
+		 * @return The file descriptor of the client at that position.
+		 */
+		int fdAt(size_t index) const;
+};
+
+#endif
\ No newline at end of file
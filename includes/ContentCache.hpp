@@ -0,0 +1,118 @@
+#ifndef CONTENT_CACHE_HPP
+# define CONTENT_CACHE_HPP
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+
+#include "SharedBuffer.hpp"
+#include "Structs.hpp"
+
+// Largest response kept by the content cache, bigger files are sent with sendfile() as before
+# define STATIC_CACHE_MAX_ENTRY 262144
+
+/**
+ * @brief Size bounded LRU cache of complete static file responses (headers and body).
+ *
+ * Every content encoding of a file is an entry of its own, so clients that accept gzip are served
+ * from memory as well.
+ * A hit is answered from memory without touching the file system. Every directory holding a cached file
+ * is watched with inotify, any change below it drops the affected entries, so edits and uploads are visible
+ * immediately. The event loop has to call `start()` before it serves requests and `processEvents()`
+ * when `getNotifyFd()` becomes readable.
+ * Every event loop has its own cache, it is not thread safe.
+ */
+class ContentCache {
+	private:
+		struct Entry {
+			SharedBuffer* response;
+			// The normalised path of the request, the key also holds the encoding
+			std::string path;
+			// The file the response was read from
+			std::string source;
+			std::list<std::string>::iterator recent;
+		};
+
+		std::map<std::string, Entry> entries;
+		// Keys from the most to the least recently used
+		std::list<std::string> recent;
+		size_t maxSize;
+		size_t usedSize;
+		int notifyFd;
+		// Watched directory of every inotify watch descriptor
+		std::map<int, std::string> watches;
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+
+		void drop(std::map<std::string, Entry>::iterator it);
+		static bool isBelow(const std::string& path, const std::string& directory);
+		static std::string makeKey(const std::string& path, ContentEncoding encoding);
+
+		ContentCache(const ContentCache&);
+		ContentCache& operator=(const ContentCache&);
+	public:
+		/**
+		 * @param maxSize The number of response bytes kept, 0 disables the cache.
+		 */
+		ContentCache(size_t maxSize);
+		~ContentCache();
+
+		/**
+		 * @brief Creates the inotify instance. Called by the process that runs the event loop, a worker
+		 * process must not share the instance of the master it was forked from, or only one of them
+		 * would see each event. The cache stays disabled until then.
+		 */
+		void start();
+
+		/**
+		 * @brief Normalises a path so that the paths of requests and of inotify events compare equal.
+		 */
+		static std::string normalize(const std::string& path);
+
+		/**
+		 * @return The cached response in `encoding` for the file at `path` (see `normalize()`), or NULL.
+		 * The buffer belongs to the cache, `SharedBuffer::retain()` it to keep it.
+		 */
+		SharedBuffer* lookup(const std::string& path, ContentEncoding encoding);
+
+		/**
+		 * @brief Starts watching the directory of `path`. Has to succeed before the file is read for `insert()`,
+		 * so that a change while it is read is not missed.
+		 *
+		 * @return False if the cache is disabled or the directory can not be watched.
+		 */
+		bool watch(const std::string& path);
+
+		/**
+		 * @brief Stores the response for `path`, which was read from `source`. `response` is left empty.
+		 *
+		 * @param encoding The encoding the client accepts, the response itself may be sent as identity.
+		 * @return The cached response, or NULL if it is too big to be cached.
+		 */
+		SharedBuffer* insert(const std::string& path, ContentEncoding encoding, const std::string& source, std::string& response);
+
+		/**
+		 * @brief Drops the entries for `path` and everything below it.
+		 */
+		void invalidate(const std::string& path);
+
+		/**
+		 * @return The inotify file descriptor, -1 if the cache is disabled.
+		 */
+		int getNotifyFd() const;
+
+		/**
+		 * @brief Reads the pending inotify events and drops the entries they concern.
+		 *
+		 * @param changed Receives the paths that changed, for other caches.
+		 */
+		void processEvents(std::vector<std::string>& changed);
+
+		size_t getHits() const;
+		size_t getMisses() const;
+		size_t getEvictions() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef DIRECTORY_CACHE_HPP
+# define DIRECTORY_CACHE_HPP
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Directories whose entries are kept per event loop
+# define DIRECTORY_CACHE_SIZE 64
+// Rendered pages kept per directory, all of them are dropped when the limit is reached
+# define DIRECTORY_CACHE_PAGES 16
+
+enum DirectorySort {
+	SORT_NAME,
+	SORT_SIZE,
+	SORT_DATE,
+	SORT_COUNT,
+};
+
+/**
+ * @brief Caches the entries and the rendered pages of listed directories.
+ *
+ * A listing is valid as long as the directory's device, inode and modification time are unchanged, which
+ * covers every entry that is created, removed or renamed in it. Every lookup does one `stat()` on the
+ * directory instead of reading all its entries. When the cache is full the least recently used listing is dropped.
+ * Every event loop has its own cache, it is not thread safe.
+ */
+class DirectoryCache {
+	public:
+		struct Entry {
+			std::string name;
+			bool directory;
+			off_t size;
+			time_t modified;
+		};
+
+		struct Listing {
+			dev_t device;
+			ino_t inode;
+			struct timespec modified;
+			// Without hidden entries, sorted by name
+			std::vector<Entry> entries;
+			// Indexes into `entries` in the order of every `DirectorySort`, built on their first use
+			std::vector<size_t> orders[SORT_COUNT];
+			// Rendered pages by the key their renderer chose
+			std::map<std::string, std::string> pages;
+			std::list<std::string>::iterator recent;
+		};
+
+	private:
+		std::map<std::string, Listing> listings;
+		// Paths from the most to the least recently used
+		std::list<std::string> recent;
+
+		void drop(std::map<std::string, Listing>::iterator it);
+
+		DirectoryCache(const DirectoryCache&);
+		DirectoryCache& operator=(const DirectoryCache&);
+	public:
+		DirectoryCache();
+		~DirectoryCache();
+
+		/**
+		 * @brief Looks up the directory at `path`, from the cache while it is unchanged.
+		 *
+		 * @return The listing, valid until the next call, or NULL if the directory can not be read.
+		 */
+		Listing* lookup(const std::string& path);
+
+		/**
+		 * @return The indexes of the entries of `listing` in the order of `sort`, ascending.
+		 */
+		static const std::vector<size_t>& sorted(Listing& listing, DirectorySort sort);
+
+		/**
+		 * @brief Reads the entries of the directory at `path` into `listing`.
+		 *
+		 * @return False if the directory can not be read.
+		 */
+		static bool load(const std::string& path, Listing& listing);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef EPOLL_POLLER_HPP
+# define EPOLL_POLLER_HPP
+
+#include "Poller.hpp"
+
+#ifdef WEBSERV_HAS_EPOLL
+
+#include <vector>
+#include <sys/epoll.h>
+
+/**
+ * @brief Linux `epoll` backend.
+ *
+ * Only ready file descriptors are returned by `wait()`, so the cost of a wakeup does not
+ * depend on the number of idle connections. Sockets added with `edgeTriggered` use `EPOLLET`.
+ */
+class EpollPoller : public Poller {
+	private:
+		int epollFd;
+		std::vector<struct epoll_event> events;
+		std::vector<bool> edgeTriggered;
+
+		/**
+		 * @brief Builds the `epoll_event` mask for the given poller events.
+		 */
+		uint32_t toEpollEvents(int fd, int events) const;
+	public:
+		EpollPoller();
+		~EpollPoller();
+
+		/**
+		 * @return True if the epoll instance was created successfully.
+		 */
+		bool isValid() const;
+
+		bool add(int fd, int events, bool edgeTriggered);
+		bool modify(int fd, int events);
+		void remove(int fd);
+		int wait(std::vector<PollerEvent>& ready, int timeout);
+		bool isEdgeTriggered() const;
+		const char* name() const;
+};
+
+#endif
+
+#endif
\ No newline at end of file
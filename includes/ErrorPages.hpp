@@ -0,0 +1,50 @@
+#ifndef ERROR_PAGES_HPP
+# define ERROR_PAGES_HPP
+
+#include <map>
+#include <string>
+
+#include "Structs.hpp"
+
+/**
+ * @brief The HTML pages of generic responses (errors, but also e.g. 201), prepared once per server block.
+ *
+ * Every status code with a reason phrase gets its page built at startup, split around the message slot,
+ * so a response only concatenates three strings. A status configured with `error_page` uses the content of
+ * that file instead, read at startup and sent as is. The pages are immutable after construction.
+ */
+class ErrorPages {
+	private:
+		struct Page {
+			// The page before and after the message, the whole file for a configured page
+			std::string head;
+			std::string tail;
+			bool configured;
+			Page() : configured(false) {};
+		};
+
+		std::map<int, Page> pages;
+
+		void addBuiltinPages();
+		static Page makePage(int statusCode);
+		static void renderPage(const Page& page, const std::string& message, std::string& body);
+	public:
+		/**
+		 * @brief Prepares the built-in page of every known status code.
+		 */
+		ErrorPages();
+
+		/**
+		 * @brief Prepares the pages of a server block, with its `error_page` files read from below its root.
+		 * A file that can not be read is reported and replaced by the built-in page.
+		 */
+		ErrorPages(const ServerConfig& serverConfig);
+
+		/**
+		 * @brief Writes the page for `statusCode` into `body`, with `message` in its info slot.
+		 * Unknown status codes get a page built on the spot.
+		 */
+		void render(int statusCode, const std::string& message, std::string& body) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef FILE_CACHE_HPP
+# define FILE_CACHE_HPP
+
+#include <map>
+#include <list>
+#include <string>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "MimeTypes.hpp"
+
+/**
+ * @brief Caches the `stat()` result, an open file descriptor and failed lookups of served paths,
+ * like nginx's `open_file_cache`.
+ *
+ * An entry is trusted for `valid` seconds, so a hot file is served without any syscall on its path.
+ * After that the path is looked up again and the descriptor is kept if it still refers to the same,
+ * unchanged file. When the cache is full the least recently used entry is dropped.
+ * Every event loop has its own cache, it is not thread safe.
+ */
+class FileCache {
+	public:
+		struct Entry {
+			// 0, or the errno of the failed lookup, e.g. ENOENT
+			int error;
+			struct stat info;
+			// Opened (O_RDONLY) on the first lookup that asks for it, -1 otherwise
+			int fd;
+			// Resolved from the extension once per path, owned by the `MimeTypes`
+			const std::string* contentType;
+			time_t validUntil;
+			std::list<std::string>::iterator recent;
+			Entry() : error(0), fd(-1), contentType(NULL), validUntil(0) {};
+		};
+
+	private:
+		std::map<std::string, Entry> entries;
+		// Paths from the most to the least recently used
+		std::list<std::string> recent;
+		size_t maxEntries;
+		int valid;
+		const MimeTypes& mimeTypes;
+		// The result of the last lookup while the cache is disabled
+		Entry uncached;
+
+		void refresh(const std::string& path, Entry& entry);
+		void openEntry(const std::string& path, Entry& entry);
+		void drop(std::map<std::string, Entry>::iterator it);
+		static void closeEntry(Entry& entry);
+		static time_t now();
+
+		FileCache(const FileCache&);
+		FileCache& operator=(const FileCache&);
+	public:
+		/**
+		 * @param maxEntries The number of paths kept, 0 disables the cache.
+		 * @param valid Seconds an entry is used without looking at the path again.
+		 * @param mimeTypes Resolves the content type of the entries, has to outlive the cache.
+		 */
+		FileCache(size_t maxEntries, int valid, const MimeTypes& mimeTypes);
+		~FileCache();
+
+		/**
+		 * @brief Looks up `path`, from the cache while its entry is valid.
+		 *
+		 * @param open Opens a regular file unless its descriptor is cached already. Without it only the
+		 * metadata is needed, e.g. for a conditional request, and the file is not opened.
+		 * @return The entry, valid until the next call. Its descriptor stays owned by the cache.
+		 */
+		const Entry& lookup(const std::string& path, bool open = false);
+
+		/**
+		 * @brief Forgets `path` and everything below it, for changes made by the server itself (uploads, deletes)
+		 * or reported by the `ContentCache`.
+		 */
+		void invalidate(const std::string& path);
+};
+
+#endif
\ No newline at end of file
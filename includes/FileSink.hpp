@@ -0,0 +1,54 @@
+#ifndef FILE_SINK_HPP
+# define FILE_SINK_HPP
+
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief Writes a file under a temporary name and moves it to its final path once it is complete.
+ *
+ * The temporary file is created next to the target, so publishing it is a single `link()` on the same
+ * file system: readers never see a partial file, and an existing file is never overwritten. A file that
+ * is not committed, e.g. because the client disconnected, is removed again.
+ */
+class FileSink {
+	private:
+		int fd;
+		std::string path;
+		std::string tempPath;
+		bool failed;
+
+		FileSink(const FileSink&);
+		FileSink& operator=(const FileSink&);
+	public:
+		FileSink();
+		~FileSink();
+
+		/**
+		 * @brief Creates the temporary file for `path`.
+		 *
+		 * @return False if the file could not be created.
+		 */
+		bool open(const std::string& path);
+
+		bool isOpen() const;
+
+		/**
+		 * @brief Appends to the file. A failed write is remembered and reported by `commit()`.
+		 */
+		void write(const char* data, size_t length);
+
+		/**
+		 * @brief Closes the file and moves it to its final path.
+		 *
+		 * @return 0 on success, otherwise the errno of the failure (`EEXIST` if the path was taken meanwhile).
+		 */
+		int commit();
+
+		/**
+		 * @brief Closes and removes the temporary file.
+		 */
+		void abort();
+};
+
+#endif
\ No newline at end of file
@@ -10,36 +10,37 @@
 #include <vector>
 #include "Logger.hpp"
 #include "Utils.hpp"
+#include "RequestParser.hpp"
+#include "MultipartParser.hpp"
+
+/**
+ * @brief A file sent as one part of a multipart/form-data body.
+ */
+struct UploadedFile {
+	std::string fileName;
+	std::string contentType;
+	std::string content;
+};
 
-class HTTPRequest {
+class HTTPRequest : public MultipartSink {
 	private:
 		std::string method;
 		std::string uri;
 		std::string version;
-		std::map<std::string, std::string> headers;
+		const std::string* buffer;
+		const RequestParser* parser;
 		std::string body;
-		std::string fileName;
-		std::string fileContentType;
-
-		/**
-		 * @brief Parses the headers from the given input stream.
-		 *
-		 * This function reads the headers from the provided input stream and processes them accordingly.
-		 * The headers are expected to be in the format of "key: value" pairs, with each pair separated by a newline.
-		 *
-		 * @param stream The input stream containing the headers.
-		 */
-		void parseHeaders(std::istringstream& stream);
+		std::vector<UploadedFile> files;
+		std::map<std::string, std::string> formFields;
+		std::string* currentPart;
 
 		/**
 		 * @brief Parses the body of the HTTP request.
 		 *
-		 * This function takes an `std::istringstream` object as input and parses the body of the HTTP request.
+		 * The body is taken from the buffer at the offset and length found by the parser.
 		 * The parsed body is then stored or processed as required by the application (e.g., form data/normal body).
-		 *
-		 * @param stream The input stream containing the body of the HTTP request.
 		 */
-		void parseBody(std::istringstream& stream);
+		void parseBody();
 
 		/**
 		 * @brief Extracts the value associated with a given key from a header string.
@@ -54,46 +55,31 @@ class HTTPRequest {
 		std::string extractHeaderValue(const std::string& header, const std::string& key);
 
 		/**
-		 * @brief Parses a multi-part file from the given input stream using the specified boundary.
+		 * @brief Parses a multipart/form-data body using the specified boundary.
 		 *
-		 * This function reads the input stream and extracts the contents of a multi-part file
-		 * that is delimited by the specified boundary.
+		 * Parts with a file name are collected in `files`, all other parts are stored as form fields.
+		 * An incomplete body, i.e. one without the closing delimiter, does not yield any part.
 		 *
-		 * @param stream The input stream from which to read the multi-part file.
-		 * @param boundary The boundary string that delimits the multi-part file.
+		 * @param begin The start of the request body.
+		 * @param end The end of the request body.
+		 * @param boundary The boundary parameter of the Content-Type.
 		 */
-		void parseMultipartFile(std::istream& stream, const std::string& boundary);
+		void parseMultipart(const char* begin, const char* end, const std::string& boundary);
 
-		/**
-		 * @brief Parses the multipart headers from the given buffer.
-		 *
-		 * This function takes a vector of characters as input and parses the multipart headers from it.
-		 * The parsed headers are then used for further processing.
-		 *
-		 * @param buffer The vector of characters containing the multipart headers.
-		 */
-		void parseMultipartHeaders(const std::vector<char>& buffer);
-
-		/**
-		 * Extracts the boundary string from the given content type.
-		 *
-		 * @param contentType The content type string.
-		 * @return The boundary string extracted from the content type.
-		 */
-		std::string extractBoundary(const std::string& contentType) const;
+		void beginPart(const MultipartPart& part);
+		void partData(const char* data, size_t length);
+		void endPart();
 	public:
-		HTTPRequest();
-		HTTPRequest(const std::string& request);
-		~HTTPRequest();
-
 		/**
-		 * @brief Parses the given request.
+		 * @brief Creates the request from a buffer that was fully parsed by a `RequestParser`.
 		 *
-		 * This function parses the provided request and performs necessary operations based on the request data.
+		 * Headers are not copied, `getHeader()` reads them from the buffer, so both must outlive the request.
 		 *
-		 * @param request The request to be parsed.
+		 * @param buffer The read buffer of the connection.
+		 * @param parser The parser that returned `PARSE_COMPLETE` for the buffer.
 		 */
-		void parseRequest(const std::string& request);
+		HTTPRequest(const std::string& buffer, const RequestParser& parser);
+		~HTTPRequest();
 
 		/**
 		 * @brief Gets the HTTP method of the request.
@@ -135,23 +121,22 @@ class HTTPRequest {
 		 *
 		 * @return The body of the HTTP request.
 		 */
-		std::string getBody() const;
+		const std::string& getBody() const;
 
 		/**
-		 * @brief Gets the file name from the HTTP request.
-		 * 
-		 * This function returns the file name extracted from the HTTP request.
-		 * 
-		 * @return The file name as a string.
+		 * @brief Gets the files sent in a multipart/form-data body.
+		 *
+		 * @return The files in the order they were sent, empty for other bodies.
 		 */
-		std::string getFileName() const;
+		const std::vector<UploadedFile>& getFiles() const;
 
 		/**
-		 * @brief Gets the content type of the file associated with the HTTP request.
+		 * @brief Gets a form field sent in a multipart/form-data body.
 		 *
-		 * @return The content type of the file as a string.
+		 * @param name The name of the field.
+		 * @return The value of the field, or an empty string if it was not sent.
 		 */
-		std::string getFileContentType() const;
+		std::string getFormField(const std::string& name) const;
 };
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 # define HTTP_RESPONSE_HPP
 
 #include <map>
+#include <vector>
 #include <string>
 #include <sstream>
 #include <fstream>
@@ -19,19 +20,98 @@
 #include "Structs.hpp"
 #include "Utils.hpp"
 #include "HTTPRequest.hpp"
+#include "FileCache.hpp"
+#include "ContentCache.hpp"
+#include "ErrorPages.hpp"
+#include "DirectoryCache.hpp"
+#include "Compression.hpp"
+#include "CGIHeaders.hpp"
 
 # define CGI_TIMEOUT 5
+// More ranges than this in one request are ignored and the whole file is sent
+# define RANGE_MAX_PARTS 16
+// Entries per page of a directory listing, unless the request asks for another `limit` up to the maximum
+# define LISTING_PAGE_SIZE 1000
+# define LISTING_PAGE_SIZE_MAX 10000
 
 class HTTPResponse {
 	private:
 		int statusCode;
-		std::map<std::string, std::string> headers;
+		// In the order they were first set, a response only has a handful
+		std::vector<std::pair<std::string, std::string> > headers;
 		static const std::map<int, std::string> statusCodes;
+		// "HTTP/1.1 <code> <reason>\r\n" for every code from 100 to 599, formatted once
+		static const std::vector<std::string> statusLines;
 		std::string body;
+		// The file body, sent after the headers by the socket manager: the whole file or one range,
+		// or the parts of a multipart/byteranges response followed by its closing boundary in `body`
+		std::vector<FileBody> files;
+		// The path the file body was opened from
+		std::string filePath;
+		// A complete response from the content cache, replaces everything else
+		SharedBuffer* cached;
+		// A compressed file from the compression cache, sent instead of `body`
+		SharedBuffer* sharedBody;
+		// Looks up the served files, NULL to go to the file system every time
+		FileCache* fileCache;
+		// Answers GET requests for small static files, NULL to disable it
+		ContentCache* contentCache;
+		// The pages of generic responses of the server block, NULL for the built-in pages
+		const ErrorPages* errorPages;
+		// Entries and pages of listed directories, NULL to read the directory every time
+		DirectoryCache* directoryCache;
+		// The query string of a GET request, without the '?'
+		std::string query;
+		// Compresses the response, NULL if `gzip` is off for the request
+		Compression* compression;
+		// The encoding the client accepts
+		ContentEncoding encoding;
+		// Set for HEAD requests, the body is left out when the response is queued
+		bool headOnly;
+		// The body follows the headers later, chunked or until the connection closes, so there is no `Content-Length`
+		bool streamed;
+		// The validators of a conditional GET or HEAD request
+		std::string ifNoneMatch;
+		std::string ifModifiedSince;
+		// The `Range` and `If-Range` headers of a GET request
+		std::string range;
+		std::string ifRange;
 
 		static std::map<int, std::string> initializeStatusCodes();
+		static std::vector<std::string> initializeStatusLines();
+		// Closes the file body and releases the cached response
+		void dropBody();
+		// Opens a regular file for the body and updates `fileStat` to the opened file, -1 on failure
+		int openFile(const std::string& path, struct stat& fileStat);
+		bool isNotModified(const struct stat& fileStat, ContentEncoding encoding) const;
+		// Every encoding of a file is a representation of its own with a distinct strong ETag
+		static std::string makeETag(const struct stat& fileStat, ContentEncoding encoding = ENCODING_IDENTITY);
+		const std::string* findHeader(const std::string& key) const;
+		/**
+		 * @brief Parses the `Range` header against a file of `size` bytes.
+		 *
+		 * @param ranges Receives the satisfiable ranges as offset and length.
+		 * @return 206 with `ranges` filled, 416 if no range is satisfiable, or 200 if the whole file is sent
+		 * because there is no usable `Range` header.
+		 */
+		int parseRanges(const struct stat& fileStat, std::vector<std::pair<off_t, size_t> >& ranges) const;
+		// Assigns the 206 response for `ranges`, takes ownership of `fd`. False if the parts could not be set up.
+		bool assignRanges(int fd, const struct stat& fileStat, const std::string& contentType,
+			const std::vector<std::pair<off_t, size_t> >& ranges);
+		static std::string makeBoundary();
+		/**
+		 * @brief Serves one page of the entries of a directory, sorted as the query asks
+		 * (`sort=name|size|date`, `order=asc|desc`, `page`, `limit`).
+		 *
+		 * @param deletePage Adds a delete button to every entry.
+		 */
+		void serveListing(const std::string& uri, const std::string& fullPath, bool deletePage);
+		static std::string listingLink(const std::string& uri, const std::string& sort, bool descending, size_t page, size_t limit);
+
+		HTTPResponse(const HTTPResponse&);
+		HTTPResponse& operator=(const HTTPResponse&);
 	public:
-		HTTPResponse();
+		HTTPResponse(FileCache* fileCache = NULL, ContentCache* contentCache = NULL, DirectoryCache* directoryCache = NULL);
 		~HTTPResponse();
 		
 		/**
@@ -59,12 +139,13 @@ class HTTPResponse {
 		/**
 		 * Handles a POST request.
 		 *
-		 * This function is responsible for processing a POST request and generating an appropriate response.
+		 * The body was already streamed to disk by the client's `Upload` while it arrived, this function
+		 * publishes the last file and generates the response from the outcome.
 		 *
 		 * @param request The HTTPRequest object representing the incoming request.
-		 * @param serverConfig The ServerConfig object containing the server configuration settings.
+		 * @param client The ClientState object representing the client connection.
 		 */
-		void handleRequestPOST(const HTTPRequest& request, const ServerConfig& serverConfig);
+		void handleRequestPOST(const HTTPRequest& request, ClientState& client);
 
 		/**
 		 * Handles a DELETE request.
@@ -101,6 +182,58 @@ class HTTPResponse {
 		 */
 		void assignGenericResponse(int statusCode, const std::string& message = "");
 
+		/**
+		 * @brief Assigns the response of a CGI script from its parsed header block and its body.
+		 *
+		 * Without a `Content-Type` from the script the body is sent as `text/html`.
+		 */
+		void assignCGIResponse(const CGIHeaders& headers, const std::string& body);
+
+		/**
+		 * @brief Leaves the body out of the response, it is sent separately as it is produced.
+		 *
+		 * @param chunked Frames the body with `Transfer-Encoding: chunked`, otherwise it ends with the connection.
+		 */
+		void setStreamed(bool chunked);
+
+		/**
+		 * @brief Assigns a response whose body is the file at `path`.
+		 *
+		 * The response carries a strong `ETag` (inode, size and modification time) and `Last-Modified`.
+		 * A conditional request whose validators still match is answered with 304, and a HEAD request with
+		 * the headers only, both from the file's metadata without opening it. Otherwise the file is opened
+		 * here, or its descriptor is duplicated from the file cache. Its content is never read into the
+		 * response, the socket manager sends it with `sendfile()` after the headers, see `releaseFiles()`.
+		 * A 200 response to a `Range` request becomes a 206 with the requested byte ranges, as a
+		 * `multipart/byteranges` body for several ranges, or a 416 if none of them is satisfiable.
+		 *
+		 * @param statusCode The HTTP status code to be set in the response.
+		 * @param path The path of the file.
+		 * @param contentType The type of content in the file.
+		 * @return False if the file could not be opened or is not a regular file, the response is left unchanged.
+		 */
+		bool assignFile(int statusCode, const std::string& path, const std::string& contentType);
+
+		/**
+		 * @brief Gets the `stat()` result of `path`, from the file cache if the response has one.
+		 *
+		 * @return False if the path does not exist or can not be accessed.
+		 */
+		bool lookupFile(const std::string& path, struct stat& info);
+
+		/**
+		 * @brief Moves the in-memory body of the response into `body` without copying it.
+		 */
+		void releaseBody(std::string& body);
+
+		/**
+		 * @brief Hands the file parts of the response over to the caller, who becomes responsible for closing them.
+		 * They are sent before the in-memory body, see `releaseBody()`.
+		 *
+		 * @param files Receives the parts, empty if the response has none.
+		 */
+		void releaseFiles(std::vector<FileBody>& files);
+
 		/**
 		 * @brief Serves a file to the client.
 		 * 
@@ -112,6 +245,45 @@ class HTTPResponse {
 		 */
 		void serveFile(ClientState& client, const std::string& uri);
 
+		/**
+		 * @brief Assigns the response for the file at `path` from the content cache.
+		 *
+		 * @param path The full path of the requested file.
+		 * @return False if the response is not cached.
+		 */
+		bool serveCached(const std::string& path);
+
+		/**
+		 * @brief Stores a static file response that was just assigned for `path` in the content cache.
+		 *
+		 * Only complete 200 responses with a file body small enough for the cache are stored, under the
+		 * encoding the client accepts. The response then continues with the cached copy instead of the file.
+		 *
+		 * @param path The full path of the requested file.
+		 */
+		void storeInCache(const std::string& path);
+
+		/**
+		 * @brief Like `storeInCache()`, for a file body from the compression cache.
+		 */
+		void storeCompressedInCache(const std::string& path);
+
+		/**
+		 * @return The response from the content cache, NULL if it was assigned differently.
+		 */
+		SharedBuffer* getCached() const;
+
+		/**
+		 * @return The compressed file body, sent after the headers, NULL if the response has none.
+		 */
+		SharedBuffer* getSharedBody() const;
+
+		/**
+		 * @brief Compresses the in-memory body (directory listings, CGI output, generic pages) if the client
+		 * accepts it and its type and size qualify. Static files are compressed by `assignFile()`.
+		 */
+		void compressBody();
+
 		/**
 		 * @brief Serves the index page for the given server configuration.
 		 *
@@ -140,6 +312,7 @@ class HTTPResponse {
 		 *
 		 * This function generates a directory listing HTML page for the specified URI and full path.
 		 * The generated HTML page includes links to the files and subdirectories within the directory.
+		 * Big directories are split into pages, see `serveListing()`.
 		 *
 		 * @param uri The URI of the directory.
 		 * @param fullPath The full path of the directory on the server.
@@ -151,6 +324,7 @@ class HTTPResponse {
 		 *
 		 * This function is responsible for serving a delete page for the given URI and full path.
 		 * It takes the URI and full path as parameters and performs the necessary operations to serve the delete page.
+		 * Big directories are split into pages, see `serveListing()`.
 		 *
 		 * @param uri The URI of the delete page.
 		 * @param fullPath The full path of the delete page.
@@ -160,17 +334,42 @@ class HTTPResponse {
 		/**
 		 * Converts the HTTP response object to a string representation.
 		 *
+		 * For a file response only the headers are returned, the body follows from `releaseFiles()`.
+		 * A cached response is returned as it was stored.
+		 *
 		 * @return The string representation of the HTTP response.
 		 */
 		std::string convertToString() const;
 
 		/**
-		 * Determines the content type of the response based on the given request URI.
+		 * @return The status line and the headers of the response, including the empty line that ends them.
+		 */
+		std::string convertHeadersToString() const;
+
+		/**
+		 * @brief Appends the status line and the `Date` header, the part of the head that is not cached.
+		 */
+		void appendStatusLine(std::string& out) const;
+
+		/**
+		 * @brief Appends the other headers and the empty line that ends them.
+		 */
+		void appendHeaders(std::string& out) const;
+
+		/**
+		 * @return The reason phrase of every known status code.
+		 */
+		static const std::map<int, std::string>& getStatusCodes();
+
+		/**
+		 * Determines the content type of a file from its extension, see `MimeTypes`.
+		 *
+		 * The type is resolved once per path and kept in the file cache entry.
 		 *
-		 * @param requestURI The URI of the request.
+		 * @param path The full path of the file.
 		 * @return The content type of the response as a string.
 		 */
-		std::string determineContentType(std::string requestURI);
+		const std::string& determineContentType(const std::string& path);
 
 		/**
 		 * @brief Serves a regular file.
@@ -199,7 +398,7 @@ class HTTPResponse {
 		 * @param serverConfig The server configuration.
 		 * @return A string indicating the redirection URL if the URI is a redirection, an empty string otherwise.
 		 */
-		std::string isRedirection(const std::string& uri, const ServerConfig& serverConfig);
+		static std::string isRedirection(const std::string& uri, const ServerConfig& serverConfig);
 
 		/**
 		 * @brief Extracts the folder name from a given URI.
@@ -220,6 +419,40 @@ class HTTPResponse {
 		 */
 		bool cheekySlashes(const std::string& uri);
 
+		/**
+		 * @brief Enables compression of the response for a location with `gzip on`.
+		 *
+		 * @param encoding The encoding negotiated with `Compression::negotiate()`, for the `Vary` header
+		 * the response is prepared for compression even if it is `ENCODING_IDENTITY`.
+		 */
+		void setCompression(Compression* compression, ContentEncoding encoding);
+
+		/**
+		 * @return True if `gzip` is on for the most specific location of `uri`, or else for the server.
+		 */
+		static bool isGzipEnabled(const std::string& uri, const ServerConfig& serverConfig);
+
+		/**
+		 * @return The location with the longest path that prefixes `uri`, NULL if there is none.
+		 */
+		static const LocationConfig* findLocation(const std::string& uri, const ServerConfig& serverConfig);
+
+		/**
+		 * @brief Sets the pages used by `assignGenericResponse()`, usually those of the request's server block.
+		 */
+		void setErrorPages(const ErrorPages* errorPages);
+
+		/**
+		 * @brief Makes the response to a HEAD request: it keeps its headers, including `Content-Length`,
+		 * but its body is not sent.
+		 */
+		void setHeadOnly(bool headOnly);
+
+		/**
+		 * @return True if the body of the response must not be sent.
+		 */
+		bool isHeadOnly() const;
+
 		/**
 		 * @brief Sets the status code of the HTTP response.
 		 *
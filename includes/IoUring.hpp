@@ -0,0 +1,126 @@
+#ifndef IO_URING_HPP
+# define IO_URING_HPP
+
+#if defined(__linux__) && !defined(WEBSERV_NO_IO_URING) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT)
+#   define WEBSERV_HAS_IO_URING 1
+#  endif
+# endif
+#endif
+
+#ifdef WEBSERV_HAS_IO_URING
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * @brief Minimal wrapper around a raw io_uring instance (no liburing).
+ *
+ * Owns the submission and completion rings and one ring of provided receive buffers.
+ * Submissions are queued with `getSqe()` and handed to the kernel in one batch by `submitAndWait()`.
+ */
+class IoUring {
+	private:
+		int ringFd;
+		void* sqRing;
+		size_t sqRingSize;
+		void* cqRing;
+		size_t cqRingSize;
+		struct io_uring_sqe* sqes;
+		size_t sqesSize;
+		unsigned* sqHead;
+		unsigned* sqTail;
+		unsigned sqMask;
+		unsigned sqEntries;
+		unsigned* cqHead;
+		unsigned* cqTail;
+		unsigned cqMask;
+		struct io_uring_cqe* cqes;
+		unsigned localTail;
+		unsigned pending;
+
+		struct io_uring_buf_ring* bufRing;
+		size_t bufRingSize;
+		char* buffers;
+		unsigned bufCount;
+		unsigned bufSize;
+		unsigned short bufGroup;
+		unsigned short bufTail;
+
+		/**
+		 * @brief Passes all queued submissions to the kernel, optionally waiting for completions.
+		 * @return The result of `io_uring_enter`.
+		 */
+		int enter(unsigned waitNr, int timeout);
+
+		IoUring(const IoUring&);
+		IoUring& operator=(const IoUring&);
+	public:
+		IoUring();
+		~IoUring();
+
+		/**
+		 * @brief Creates the ring and maps its memory.
+		 *
+		 * @param entries The number of submission queue entries.
+		 * @return False if io_uring is not available at runtime (old kernel, seccomp, ...).
+		 */
+		bool setup(unsigned entries);
+
+		/**
+		 * @brief Registers a ring of provided buffers that receives select from (`IOSQE_BUFFER_SELECT`).
+		 *
+		 * @param group The buffer group id used in `sqe->buf_group`.
+		 * @param count The number of buffers, must be a power of two.
+		 * @param size The size of every buffer.
+		 * @return False if the kernel does not support provided buffer rings.
+		 */
+		bool setupBuffers(unsigned short group, unsigned count, unsigned size);
+
+		/**
+		 * @brief Returns a zeroed submission queue entry, flushing the queue to the kernel if it is full.
+		 */
+		struct io_uring_sqe* getSqe();
+
+		/**
+		 * @brief Submits everything queued and waits for at least one completion.
+		 *
+		 * Does not block if completions are already waiting.
+		 *
+		 * @param timeout The timeout in milliseconds, -1 waits forever.
+		 * @return -1 on error (`errno` is set), otherwise a non-negative value.
+		 */
+		int submitAndWait(int timeout);
+
+		/**
+		 * @brief Returns the next completion, or NULL if there is none. Must be followed by `advance()`.
+		 */
+		struct io_uring_cqe* peek();
+
+		/**
+		 * @brief Marks the completion returned by `peek()` as consumed.
+		 */
+		void advance();
+
+		/**
+		 * @param bid The buffer id taken from `cqe->flags`.
+		 * @return The provided buffer with the given id.
+		 */
+		char* getBuffer(unsigned short bid);
+
+		/**
+		 * @brief Hands a provided buffer back to the kernel once its data was consumed.
+		 */
+		void recycleBuffer(unsigned short bid);
+
+		/**
+		 * @return The buffer group id registered with `setupBuffers()`.
+		 */
+		unsigned short getBufferGroup() const;
+};
+
+#endif
+
+#endif
\ No newline at end of file
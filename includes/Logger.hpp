@@ -6,6 +6,7 @@
 #include <string>
 #include <sstream> 
 #include <ctime>
+#include <pthread.h>
 
 class Logger;
 
@@ -107,6 +108,8 @@ class Logger {
 		static bool useFileLine;
 		static bool useTimestamp;
 		static bool useLevel;
+		// Serialises writes to `output` when running with worker threads.
+		static pthread_mutex_t mutex;
 
 		/**
 		 * @brief A string representation of the log level
@@ -0,0 +1,52 @@
+#ifndef MIME_TYPES_HPP
+# define MIME_TYPES_HPP
+
+#include <vector>
+#include <string>
+
+/**
+ * @brief Maps file extensions to MIME types, like nginx's `types {}` block.
+ *
+ * An open addressing hash table keyed on the lowercase extension, filled once at startup with the built-in
+ * types and those of the configuration, then only read. A lookup hashes the extension of the path in place,
+ * without copying or lowercasing it.
+ */
+class MimeTypes {
+	private:
+		struct Slot {
+			std::string extension;
+			std::string type;
+		};
+
+		// Always a power of two, at most half of them used
+		std::vector<Slot> slots;
+		size_t count;
+		std::string defaultType;
+
+		static size_t hash(const char* extension, size_t length);
+		size_t find(const char* extension, size_t length) const;
+		void grow();
+	public:
+		/**
+		 * @brief Starts with the built-in types of common web content and `application/octet-stream` as default.
+		 */
+		MimeTypes();
+
+		/**
+		 * @brief Maps `extension` (without the dot, any case) to `type`, replacing an earlier mapping.
+		 */
+		void add(const std::string& extension, const std::string& type);
+
+		/**
+		 * @brief Sets the type of files whose extension is unknown.
+		 */
+		void setDefaultType(const std::string& type);
+
+		/**
+		 * @return The type for the extension of the last path segment of `path`, or the default type.
+		 * The reference stays valid as long as the table is not changed.
+		 */
+		const std::string& resolve(const std::string& path) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef MULTIPART_PARSER_HPP
+# define MULTIPART_PARSER_HPP
+
+#include <string>
+#include <cstddef>
+
+// Upper limit for the header block of a single part
+# define MULTIPART_HEADER_LIMIT 8192
+
+/**
+ * @brief The headers of one part of a multipart/form-data body.
+ */
+struct MultipartPart {
+	std::string name;
+	std::string fileName;
+	std::string contentType;
+};
+
+/**
+ * @brief Receives the parts found by a `MultipartParser`.
+ *
+ * The payload of a part is passed on in pieces as soon as it is known not to contain the delimiter,
+ * so a sink can write a file without ever holding all of it.
+ */
+class MultipartSink {
+	public:
+		virtual ~MultipartSink() {};
+		virtual void beginPart(const MultipartPart& part) = 0;
+		virtual void partData(const char* data, size_t length) = 0;
+		virtual void endPart() = 0;
+};
+
+enum MultipartState {
+	MULTIPART_PREAMBLE,
+	MULTIPART_DELIMITER,
+	MULTIPART_HEADERS,
+	MULTIPART_BODY,
+	MULTIPART_DONE,
+	MULTIPART_ERROR,
+};
+
+/**
+ * @brief Streaming parser for multipart/form-data bodies (RFC 7578).
+ *
+ * The body can be fed in arbitrary pieces. Delimiters are located with a Boyer-Moore-Horspool search,
+ * which skips up to the length of the delimiter per comparison. Only the few bytes that might be the
+ * start of a delimiter split across two pieces, and an incomplete part header block, are buffered.
+ */
+class MultipartParser {
+	private:
+		std::string delimiter;
+		size_t skip[256];
+		MultipartState state;
+		std::string pending;
+		MultipartSink* sink;
+
+		/**
+		 * @brief Parses as much of the range as possible.
+		 *
+		 * @return The number of bytes consumed, the rest has to be passed again with more data behind it.
+		 */
+		size_t process(const char* begin, const char* end);
+
+		/**
+		 * @return The start of the first delimiter in the range, or `end`.
+		 */
+		const char* findDelimiter(const char* begin, const char* end) const;
+
+		/**
+		 * @brief Reads name, file name and content type from the header block of a part.
+		 */
+		static void parsePartHeaders(const char* begin, const char* end, MultipartPart& part);
+
+		/**
+		 * @return The value of a `key=value` or `key="value"` parameter of a header value.
+		 */
+		static std::string extractParameter(const std::string& value, const std::string& key);
+
+		MultipartParser(const MultipartParser&);
+		MultipartParser& operator=(const MultipartParser&);
+	public:
+		/**
+		 * @param boundary The boundary parameter of the Content-Type, without the leading dashes.
+		 * @param sink Receives the parts, it has to outlive the parser.
+		 */
+		MultipartParser(const std::string& boundary, MultipartSink& sink);
+		~MultipartParser();
+
+		/**
+		 * Extracts the boundary string from the given content type.
+		 *
+		 * @param contentType The content type string.
+		 * @return The boundary parameter without surrounding quotes, or an empty string.
+		 */
+		static std::string extractBoundary(const std::string& contentType);
+
+		/**
+		 * @brief Parses the next piece of the body.
+		 */
+		void feed(const char* data, size_t length);
+
+		/**
+		 * @return True once the closing delimiter was parsed.
+		 */
+		bool done() const;
+
+		/**
+		 * @return True if the body is not valid multipart/form-data.
+		 */
+		bool failed() const;
+};
+
+#endif
\ No newline at end of file
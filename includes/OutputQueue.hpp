@@ -0,0 +1,123 @@
+#ifndef OUTPUT_QUEUE_HPP
+# define OUTPUT_QUEUE_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#include "SharedBuffer.hpp"
+
+// Maximum number of memory segments handed to a single writev()/sendmsg()
+# define OUTPUT_IOV_MAX 64
+
+/**
+ * @brief The output of a connection: a queue of memory segments (header blocks, bodies, cached responses) and file ranges.
+ *
+ * Memory segments at the front are flushed together with `writev()`, file ranges with `sendfile()`.
+ * A partial send only advances an offset into the front segment, nothing is moved, and a segment is
+ * freed as soon as it was sent completely. Responses of pipelined requests simply follow each other.
+ *
+ * Segments are never changed while they are queued, so the io_uring backend can send straight from them.
+ */
+class OutputQueue {
+	private:
+		struct Segment {
+			std::string data;
+			// A cached response, queued instead of `data`
+			SharedBuffer* shared;
+			// -1 for a memory segment
+			int fd;
+			off_t offset;
+			size_t length;
+			Segment() : shared(NULL), fd(-1), offset(0), length(0) {};
+			const std::string& bytes() const { return shared ? shared->str() : data; };
+		};
+
+		std::deque<Segment> segments;
+		// Bytes of the front memory segment that were already sent
+		size_t headOffset;
+		size_t memoryBytes;
+		size_t fileCount;
+		std::vector<struct iovec> iov;
+		struct msghdr message;
+
+		void popFront();
+
+		OutputQueue(const OutputQueue&);
+		OutputQueue& operator=(const OutputQueue&);
+	public:
+		OutputQueue();
+		~OutputQueue();
+
+		/**
+		 * @brief Appends a copy of `data`.
+		 */
+		void append(const std::string& data);
+
+		/**
+		 * @brief Appends a copy of the `length` bytes at `data`.
+		 */
+		void append(const char* data, size_t length);
+
+		/**
+		 * @brief Appends `data` without copying it, `data` is left empty.
+		 */
+		void take(std::string& data);
+
+		/**
+		 * @brief Appends a shared buffer without copying it, the queue holds a reference until it was sent.
+		 */
+		void appendShared(SharedBuffer* buffer);
+
+		/**
+		 * @brief Appends `length` bytes of the file `fd` starting at `offset`. The queue closes `fd` once it was sent.
+		 */
+		void appendFile(int fd, off_t offset, size_t length);
+
+		bool empty() const;
+
+		/**
+		 * @return The number of queued bytes held in memory, file ranges are not counted.
+		 */
+		size_t size() const;
+
+		/**
+		 * @return The number of queued file ranges, each of them holds an open file descriptor.
+		 */
+		size_t files() const;
+
+		/**
+		 * @return True if the next bytes to send come from a file.
+		 */
+		bool frontIsFile() const;
+
+		/**
+		 * @brief Sends as much of the front of the queue as the socket takes in one call: the memory segments
+		 * up to the next file range with `writev()`, or the file range at the front with `sendfile()`.
+		 *
+		 * @return The number of bytes sent, or -1 with `errno` set. A file that got shorter than announced fails with `EIO`.
+		 */
+		ssize_t send(int socket);
+
+		/**
+		 * @brief Describes the memory segments at the front of the queue for a `sendmsg()` that completes later.
+		 *
+		 * The segments stay valid until the sent bytes are passed to `consume()`.
+		 */
+		struct msghdr* prepareMessage();
+
+		/**
+		 * @brief Removes `length` sent bytes of memory segments from the front of the queue.
+		 */
+		void consume(size_t length);
+
+		/**
+		 * @brief Exchanges the contents of two queues. The segments themselves are not moved.
+		 */
+		void swap(OutputQueue& other);
+};
+
+#endif
\ No newline at end of file
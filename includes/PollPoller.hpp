@@ -0,0 +1,35 @@
+#ifndef POLL_POLLER_HPP
+# define POLL_POLLER_HPP
+
+#include <vector>
+#include <poll.h>
+
+#include "Poller.hpp"
+
+/**
+ * @brief Portable `poll()` backend. Level-triggered, every wait scans all watched file descriptors.
+ */
+class PollPoller : public Poller {
+	private:
+		std::vector<struct pollfd> fds;
+		// Position of every watched file descriptor in `fds`, indexed by file descriptor, -1 if not watched
+		std::vector<int> positions;
+
+		/**
+		 * @brief Finds the position of the given file descriptor in `fds` in constant time.
+		 * @return The index, or `fds.size()` if it is not watched.
+		 */
+		size_t indexOf(int fd) const;
+	public:
+		PollPoller();
+		~PollPoller();
+
+		bool add(int fd, int events, bool edgeTriggered);
+		bool modify(int fd, int events);
+		void remove(int fd);
+		int wait(std::vector<PollerEvent>& ready, int timeout);
+		bool isEdgeTriggered() const;
+		const char* name() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef POLLER_HPP
+# define POLLER_HPP
+
+#include <vector>
+#include <string>
+
+#include "Structs.hpp"
+
+#if defined(__linux__) && !defined(WEBSERV_NO_EPOLL)
+# define WEBSERV_HAS_EPOLL 1
+#endif
+
+/**
+ * @brief Readiness flags understood by every poller backend.
+ */
+enum PollerEvents {
+	POLLER_READ = 1,
+	POLLER_WRITE = 2,
+	POLLER_ERROR = 4,
+	POLLER_HANGUP = 8,
+	POLLER_INVALID = 16,
+	POLLER_EXCLUSIVE = 32,
+};
+
+/**
+ * @brief A single ready file descriptor returned by `Poller::wait()`.
+ */
+struct PollerEvent {
+	int fd;
+	int events;
+};
+
+/**
+ * @brief Interface of the readiness backends used by the event loop in `SocketManager::run()`.
+ */
+class Poller {
+	public:
+		virtual ~Poller() {}
+
+		/**
+		 * @brief Starts watching the given file descriptor.
+		 *
+		 * @param fd The file descriptor to watch.
+		 * @param events A mask of `POLLER_READ` and/or `POLLER_WRITE`. `POLLER_EXCLUSIVE` asks the
+		 * backend to wake only one of several processes waiting on the same file descriptor.
+		 * @param edgeTriggered Only report transitions to ready instead of the ready state itself.
+		 * Backends which cannot do this ignore the flag, see `isEdgeTriggered()`.
+		 * @return True if the file descriptor is now watched, false otherwise.
+		 */
+		virtual bool add(int fd, int events, bool edgeTriggered) = 0;
+
+		/**
+		 * @brief Replaces the events watched for an already added file descriptor.
+		 *
+		 * @param fd The file descriptor to update.
+		 * @param events The new mask of `POLLER_READ` and/or `POLLER_WRITE`.
+		 * @return True on success, false otherwise.
+		 */
+		virtual bool modify(int fd, int events) = 0;
+
+		/**
+		 * @brief Stops watching the given file descriptor. Must be called before it is closed.
+		 *
+		 * @param fd The file descriptor to remove.
+		 */
+		virtual void remove(int fd) = 0;
+
+		/**
+		 * @brief Waits until at least one watched file descriptor is ready or the timeout expires.
+		 *
+		 * @param ready Filled with the ready file descriptors, only those are returned.
+		 * @param timeout The timeout in milliseconds, -1 waits forever.
+		 * @return The number of ready file descriptors, or -1 on error (`errno` is set).
+		 */
+		virtual int wait(std::vector<PollerEvent>& ready, int timeout) = 0;
+
+		/**
+		 * @brief Whether client sockets are watched edge-triggered.
+		 *
+		 * When true, the handlers must read and write until `EAGAIN` since there
+		 * will be no further notification for data that is already pending.
+		 */
+		virtual bool isEdgeTriggered() const = 0;
+
+		/**
+		 * @return The name of the backend, used for logging.
+		 */
+		virtual const char* name() const = 0;
+
+		/**
+		 * @brief Creates the poller for the requested backend.
+		 *
+		 * Falls back to `poll()` if the requested backend is not compiled in or cannot be initialised.
+		 * `BACKEND_IO_URING` is not a readiness backend, it gets `epoll` when the ring cannot be used.
+		 *
+		 * @param backend The configured event backend.
+		 * @return A heap allocated poller, owned by the caller.
+		 */
+		static Poller* create(EventBackend backend);
+};
+
+#endif
\ No newline at end of file
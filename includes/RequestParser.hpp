@@ -0,0 +1,200 @@
+#ifndef REQUEST_PARSER_HPP
+# define REQUEST_PARSER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "ChunkedDecoder.hpp"
+#include "BodySink.hpp"
+
+// Upper limit for the request line and headers of one request, larger requests are rejected with 431
+# define REQUEST_HEADER_LIMIT 65536
+
+/**
+ * @brief A part of the connection's read buffer, stored as offset and length instead of a copy.
+ */
+struct Slice {
+	size_t offset;
+	size_t length;
+	Slice() : offset(0), length(0) {};
+	Slice(size_t offset, size_t length) : offset(offset), length(length) {};
+};
+
+struct HeaderSlice {
+	Slice name;
+	Slice value;
+};
+
+enum ParseState {
+	PARSE_REQUEST_LINE,
+	PARSE_HEADERS,
+	PARSE_BODY,
+	PARSE_COMPLETE,
+	PARSE_ERROR,
+};
+
+/**
+ * @brief Resumable HTTP/1.1 request parser working directly on a connection's read buffer.
+ *
+ * `parse()` is called whenever bytes were appended and continues where the previous call stopped,
+ * so every byte of the request line and headers is scanned once. Method, URI, version and headers are
+ * recorded as slices into the buffer; the header list keeps its capacity between requests, so parsing a
+ * request does not allocate. The slices stay valid as long as the parsed part of the buffer is not modified.
+ *
+ * A chunked body is decoded as it arrives: the payload is moved into a separate body buffer and the
+ * chunk framing is removed from the read buffer, so the raw body is never reassembled there.
+ * With a body sink, any body is passed on as it arrives and only the headers stay in the buffer.
+ */
+class RequestParser {
+	private:
+		ParseState state;
+		size_t lineStart;
+		size_t scanPosition;
+		Slice method;
+		Slice uri;
+		Slice version;
+		std::vector<HeaderSlice> headers;
+		size_t bodyOffset;
+		size_t contentLength;
+		bool chunked;
+		ChunkedDecoder decoder;
+		std::string chunkedBody;
+		BodySink* bodySink;
+		size_t bodyReceived;
+		int errorStatus;
+
+		/**
+		 * @brief Decodes the chunks received so far and removes their bytes from the buffer.
+		 */
+		ParseState parseChunkedBody(std::string& buffer);
+
+		/**
+		 * @brief Passes the body received so far to the body sink and removes it from the buffer.
+		 */
+		ParseState streamBody(std::string& buffer);
+
+		bool parseRequestLine(const std::string& buffer, size_t lineEnd);
+		bool parseHeaderLine(const std::string& buffer, size_t lineEnd);
+
+		/**
+		 * @brief Validates the headers the parser itself depends on once all of them were received.
+		 *
+		 * @return 0 if the body framing is valid, otherwise the status code to answer with.
+		 */
+		int finishHeaders(const std::string& buffer);
+		ParseState fail(int status);
+	public:
+		RequestParser();
+		~RequestParser();
+
+		/**
+		 * @brief Continues parsing with the bytes appended to `buffer` since the last call.
+		 *
+		 * The call that completes the headers returns `PARSE_BODY` without looking at the body, so the
+		 * caller can pick the server and apply its body limit with `setBodyLimit()` before parsing on.
+		 *
+		 * @param buffer The read buffer of the connection, the request starts at offset 0. Decoded chunks
+		 * are removed from it, everything in front of the body stays untouched.
+		 * @return `PARSE_COMPLETE` once the headers and the whole body were received, `PARSE_ERROR` for a
+		 * malformed request (see `getErrorStatus()`), otherwise the state that waits for more data.
+		 */
+		ParseState parse(std::string& buffer);
+
+		/**
+		 * @brief Sets the largest body accepted for the current request, a larger chunked body fails with 413.
+		 */
+		void setBodyLimit(size_t maxBodySize);
+
+		/**
+		 * @brief Streams the body of the current request into `sink` instead of keeping it.
+		 *
+		 * Has to be called before the body is parsed, see `parse()`. The sink has to outlive the request.
+		 */
+		void setBodySink(BodySink* sink);
+
+		/**
+		 * @brief Fails the current request with the given status, e.g. when its headers are not acceptable.
+		 */
+		void reject(int status);
+
+		/**
+		 * @brief Prepares the parser for the next request, keeping the capacity of the header list.
+		 */
+		void reset();
+
+		ParseState getState() const;
+
+		/**
+		 * @return True once the request line and all headers were parsed.
+		 */
+		bool headersComplete() const;
+
+		/**
+		 * @return The status code to answer a malformed request with (400, 413, 431 or 501).
+		 */
+		int getErrorStatus() const;
+
+		Slice getMethod() const;
+		Slice getURI() const;
+		Slice getVersion() const;
+		size_t getBodyOffset() const;
+
+		/**
+		 * @return The length of the body, for a chunked body the number of bytes decoded so far.
+		 */
+		size_t getContentLength() const;
+
+		/**
+		 * @return True if the body uses the chunked transfer coding.
+		 */
+		bool isChunked() const;
+
+		/**
+		 * @return True if the body went to a body sink, it is then not available through `getBody()`.
+		 */
+		bool isBodyStreamed() const;
+
+		/**
+		 * @return The start of the body, either in `buffer` or in the decoded chunked body. The body is
+		 * `getContentLength()` bytes long once the request is complete.
+		 */
+		const char* getBody(const std::string& buffer) const;
+
+		/**
+		 * @return The number of bytes of the buffer taken by the request, including a body that is still in it.
+		 */
+		size_t getRequestLength() const;
+
+		/**
+		 * @brief Looks up a header by its case-insensitive name.
+		 *
+		 * @param buffer The buffer that was parsed.
+		 * @param name The name of the header.
+		 * @param value Set to the value of the header, without surrounding whitespace.
+		 * @return True if the header was sent.
+		 */
+		bool findHeader(const std::string& buffer, const char* name, Slice& value) const;
+
+		/**
+		 * @return The value of the header, or an empty string if it was not sent.
+		 */
+		std::string getHeader(const std::string& buffer, const char* name) const;
+
+		/**
+		 * @return The number of parsed headers.
+		 */
+		size_t getHeaderCount() const;
+		const HeaderSlice& getHeaderAt(size_t index) const;
+
+		/**
+		 * @return A copy of the given part of the buffer.
+		 */
+		static std::string str(const std::string& buffer, const Slice& slice);
+
+		/**
+		 * @return True if the slice matches `value` ignoring ASCII case.
+		 */
+		static bool equalsIgnoreCase(const std::string& buffer, const Slice& slice, const char* value);
+};
+
+#endif
\ No newline at end of file
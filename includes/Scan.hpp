@@ -0,0 +1,73 @@
+#ifndef SCAN_HPP
+# define SCAN_HPP
+
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))) && !defined(WEBSERV_NO_SIMD)
+# define WEBSERV_HAS_SSE2 1
+#endif
+
+/**
+ * @brief One variant of the kernels, see `Scan` for what each of them returns.
+ */
+struct ScanKernels {
+	const char* (*findByte)(const char*, const char*, char);
+	const char* (*findCRLFCRLF)(const char*, const char*);
+	const char* (*findNonToken)(const char*, const char*);
+	const char* (*findSubstring)(const char*, const char*, const char*, size_t);
+	const char* name;
+};
+
+/**
+ * @brief Byte scanning kernels used by the request and multipart parsers.
+ *
+ * Each kernel exists as a scalar, an SSE2 and an AVX2 variant. The variant is picked once at
+ * startup from the features of the CPU, so the binary stays portable; the `WEBSERV_SCAN`
+ * environment variable forces one by name. All functions search the range [begin, end) and
+ * return `end` if nothing was found.
+ */
+class Scan {
+	public:
+		/**
+		 * @return The first occurrence of `c`.
+		 */
+		static const char* findByte(const char* begin, const char* end, char c);
+
+		/**
+		 * @return The start of the first "\r\n\r\n".
+		 */
+		static const char* findCRLFCRLF(const char* begin, const char* end);
+
+		/**
+		 * @return The first byte that is not a `tchar` (RFC 9110, section 5.6.2), i.e. the end of a token.
+		 */
+		static const char* findNonToken(const char* begin, const char* end);
+
+		/**
+		 * @return The start of the first occurrence of the needle. An empty needle matches at `begin`.
+		 */
+		static const char* findSubstring(const char* begin, const char* end, const char* needle, size_t needleLength);
+
+		/**
+		 * @return The name of the selected variant ("avx2", "sse2" or "scalar"), used for logging.
+		 */
+		static const char* variant();
+
+		/**
+		 * @brief Gives direct access to a variant, for the benchmark and for comparing the variants.
+		 *
+		 * @param name "avx2", "sse2" or "scalar".
+		 * @return The kernels, or NULL if the build or the CPU does not have the variant.
+		 */
+		static const ScanKernels* kernels(const char* name);
+
+		/**
+		 * @return True if `c` is a `tchar`.
+		 */
+		static bool isToken(unsigned char c);
+
+	private:
+		Scan();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef SHARED_BUFFER_HPP
+# define SHARED_BUFFER_HPP
+
+#include <string>
+
+/**
+ * @brief An immutable, reference counted buffer that can be queued on several connections without copying it.
+ *
+ * Holds the responses of the `ContentCache`. A buffer never leaves the event loop that created it,
+ * so the reference count is not atomic.
+ */
+class SharedBuffer {
+	private:
+		std::string data;
+		size_t references;
+
+		SharedBuffer() : references(1) {};
+		~SharedBuffer() {};
+		SharedBuffer(const SharedBuffer&);
+		SharedBuffer& operator=(const SharedBuffer&);
+	public:
+		/**
+		 * @brief Creates a buffer with one reference that takes over `data`, `data` is left empty.
+		 */
+		static SharedBuffer* create(std::string& data) {
+			SharedBuffer* buffer = new SharedBuffer();
+			buffer->data.swap(data);
+			return buffer;
+		};
+
+		SharedBuffer* retain() {
+			this->references++;
+			return this;
+		};
+
+		/**
+		 * @brief Drops a reference, the buffer is deleted with the last one.
+		 */
+		void release() {
+			if (--this->references == 0)
+				delete this;
+		};
+
+		const std::string& str() const {
+			return this->data;
+		};
+};
+
+#endif
\ No newline at end of file
@@ -3,9 +3,9 @@
 
 #include <vector>
 #include <map>
+#include <set>
 #include <unistd.h> 
 #include <fcntl.h>
-#include <poll.h>
 #include <errno.h>
 #include <netinet/in.h>
 #include <algorithm>
@@ -15,34 +15,108 @@
 #include <cstring>
 #include <signal.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <stdint.h>
 
 #include "Structs.hpp"
 #include "HTTPRequest.hpp"
 #include "HTTPResponse.hpp"
 #include "Logger.hpp"
 #include "Utils.hpp"
+#include "Poller.hpp"
+#include "IoUring.hpp"
+#include "ConnectionTable.hpp"
+#include "TimerWheel.hpp"
+#include "FileCache.hpp"
+#include "ContentCache.hpp"
+#include "DirectoryCache.hpp"
+#include "Compression.hpp"
+
+// Milliseconds between checks for the exit of CGI scripts that closed their output but have no pidfd
+# define CGI_CHECK_INTERVAL 10
+// Bytes read from a CGI script's output per wakeup
+# define CGI_READ_LIMIT 262144
+// A streamed CGI response stops reading the script's output while this many bytes wait to be sent
+# define CGI_BUFFER_LIMIT 262144
+// Submission queue size of the io_uring backend
+# define RING_ENTRIES 1024
+// Number and size of the provided receive buffers of the io_uring backend
+# define RING_BUFFER_COUNT 256
+# define RING_BUFFER_SIZE 16384
+// Pipelined requests are only processed while less than this many response bytes wait to be sent
+# define PIPELINE_WRITE_LIMIT 262144
+// ... and while less than this many file bodies are queued, each of them holds an open file descriptor
+# define PIPELINE_FILE_LIMIT 16
+// While processing is paused for one of the reasons above, the socket is not read once this many bytes are buffered
+# define PIPELINE_READ_LIMIT 65536
 
 class SocketManager {
 	private:
 		HTTPConfig config;
-		std::vector<struct pollfd> fds;
+		Poller* poller;
+#ifdef WEBSERV_HAS_IO_URING
+		IoUring* ring;
+		std::vector<unsigned> ringGenerations;
+		std::map<uint64_t, OutputQueue*> orphanedSends;
+		bool multishotRecv;
+		// Listeners whose accept failed with EMFILE, armed again once a descriptor is closed
+		std::vector<int> pausedAccepts;
+#else
+		void* ring;
+#endif
 		std::vector<int> server_fds;
-		std::map<int, ClientState> clientStates;
-		std::map<int, ServerConfig> serverConfigs;
+		ConnectionTable clientStates;
+		// Listening port of every server socket, indexed by file descriptor, 0 for other file descriptors
+		std::vector<int> listenPorts;
+		// Clients whose CGI script has no pidfd and closed its output, polled until it exits
+		std::set<int> cgiClients;
+		// The client of every CGI output pipe and pidfd watched by the event loop
+		std::map<int, int> cgiFds;
+		TimerWheel timers;
+		FileCache fileCache;
+		ContentCache contentCache;
+		DirectoryCache directoryCache;
+		Compression compression;
+		// The prepared pages of every server block, in the order of `config.serverConfigs`
+		std::vector<ErrorPages*> errorPages;
+		int wakeupFds[2];
+		// Reserved descriptor, given up to shed a connection when the process runs out of descriptors
+		int spareFd;
 
 		/**
-		 * @brief Accepts a new connection (client) on the server socket (server_fd).
+		 * @brief Accepts new connections (clients) on the server socket (server_fd).
 		 * 
-		 * This function initializes a new client state and adds the client to the pollfd list.
+		 * Drains the backlog until `accept4()` would block, but accepts at most `accept_batch`
+		 * connections per call so that a busy listener cannot starve the other file descriptors.
 		 * @param server_fd The server socket file descriptor to accept the connection on.
 		 */
 		void acceptNewConnections(int server_fd);
 
+		/**
+		 * @brief Handles `EMFILE`/`ENFILE` on accept by closing the spare descriptor, accepting and
+		 * immediately closing one pending connection, and reserving the spare descriptor again.
+		 *
+		 * Without this the pending connection keeps the listener readable and the loop spins.
+		 * @param server_fd The server socket file descriptor that failed to accept.
+		 */
+		void shedConnection(int server_fd);
+
+		/**
+		 * @brief Registers a freshly accepted client socket and starts reading from it.
+		 *
+		 * @param server_fd The server socket the connection was accepted on.
+		 * @param newsockfd The file descriptor of the new connection.
+		 */
+		void addClient(int server_fd, int newsockfd);
+
 
 		/**
 		 * @brief Closes the connection of the given `fd`.
 		 * 
-		 * This function also removes the file descriptor from the pollfd lists.
+		 * This function also removes the file descriptor from the poller and the connection table.
 		 * @param fd The file descriptor of the connection to close.
 		 */
 		void closeConnection(int fd);
@@ -51,6 +125,8 @@ class SocketManager {
 		 * @brief Creates a new socket and binds it to the given port.
 		 * 
 		 * Sets the socket to non-blocking mode and listens on the socket. 
+		 * With more than one worker thread `SO_REUSEPORT` is set, so that every thread
+		 * binds its own socket and the kernel spreads new connections between them.
 		 * @param port The port to bind the socket to.
 		 * @return The file descriptor of the created socket, or -1 if creating the socket failed.
 		 */
@@ -85,23 +161,90 @@ class SocketManager {
 		/**
 		 * @brief Sends a response to a client.
 		 *
-		 * Sends a response using the client's file descriptor. Handles empty write buffers, successful writes, 
+		 * Sends a response using the client's file descriptor. Handles empty output queues, successful writes, 
 		 * keep-alive connections, no data written, and write errors.
+		 * Memory segments of the output queue go out with `writev()`, file bodies with `sendfile()`.
+		 * With an edge-triggered poller it keeps sending until the socket would block.
 		 *
-		 * @param fd A reference to the pollfd struct for the client.
+		 * @param fd The file descriptor of the client socket.
 		 */
-		void sendResponse(pollfd &fd);
+		void sendResponse(int fd);
 
 		/**
 		 * @brief Reads data from the client socket.
 		 *
 		 * This function reads data from the client socket associated with the given file descriptor.
+		 * With an edge-triggered poller it keeps reading until the socket would block.
 		 *
 		 * @param fd The file descriptor of the client socket.
-		 * @return true if the data was successfully read, false otherwise.
+		 * @return true if the data was successfully read, false if the connection has to be closed.
 		 */
 		bool readClientData(int fd);
 
+		/**
+		 * @brief Checks the data buffered for a client for a complete request.
+		 *
+		 * Once the headers are complete the `Content-Length` and `Host` are extracted and the server config is assigned.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 * @return true if the headers and the whole body were received, false otherwise.
+		 */
+		bool parseClientData(int fd);
+
+		/**
+		 * @brief Processes the complete requests buffered for a client and arms it for sending.
+		 *
+		 * Pipelined requests are answered in order, their responses are appended to the output queue.
+		 * Processing stops at a request running a CGI script, at a response that closes the connection,
+		 * or once `PIPELINE_WRITE_LIMIT` bytes are waiting; `finishResponse()` picks the remaining ones up.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 */
+		void dispatchRequest(int fd);
+
+		/**
+		 * @return true while `dispatchRequest()` has to leave the buffered requests alone.
+		 */
+		static bool isDispatchPaused(const ClientState& client);
+
+		/**
+		 * @brief Stops reading from a client whose dispatch is paused with `PIPELINE_READ_LIMIT` bytes
+		 * buffered, and starts again once the dispatch continues.
+		 *
+		 * The poller loses the read interest and a multishot recv is cancelled, so a client that keeps
+		 * pipelining without reading its responses is held back by its socket buffers instead of ours.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 */
+		void updateReadPause(int fd);
+
+		/**
+		 * @brief Streams the body of an upload into the target directory instead of the read buffer.
+		 *
+		 * Called once the headers are complete. Only POST requests that will store their body get an
+		 * `Upload`; CGI requests and requests answered with 405 or a redirection are left alone.
+		 */
+		void startUpload(ClientState& client);
+
+		/**
+		 * @brief Appends a response to the client's output queue: the header block, the in-memory body
+		 * and the file body each become a segment, none of them is copied.
+		 */
+		void queueResponse(ClientState& client, HTTPResponse& response);
+
+		/**
+		 * @brief Removes the request that was just processed from the front of the read buffer.
+		 */
+		void consumeRequest(ClientState& client);
+
+		/**
+		 * @brief Called once the output queue was fully sent. Closes non-keep-alive connections,
+		 * otherwise continues with the requests pipelined behind the sent responses.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 */
+		void finishResponse(int fd);
+
 		/**
 		 * @brief Processes a request received on the given file descriptor.
 		 *
@@ -116,25 +259,80 @@ class SocketManager {
 		/**
 		 * Handles the Common Gateway Interface (CGI) request for the client.
 		 *
-		 * This function takes a reference to a `ClientState` object and a reference to a `std::string` object representing the full path of the requested resource.
-		 * It processes the CGI request and returns a `std::string` containing the response from the CGI program.
+		 * Forks the script and registers its non-blocking output pipe and its pidfd with the event loop,
+		 * the output is collected by `handleCGIEvent()` as it arrives.
 		 *
-		 * @param client The `ClientState` object representing the client making the request.
+		 * @param fd The file descriptor of the client making the request.
 		 * @param fullPath The full path of the requested resource.
-		 * @return A `std::string` containing the response from the CGI program.
+		 * @return An empty string while the script runs, or the error that prevented starting it.
 		 */
-		std::string handleCGI(ClientState& client, std::string& fullPath);
+		std::string handleCGI(int fd, std::string& fullPath);
 
 		/**
-		 * Checks and handles the child process for the given client.
-		 *
-		 * This function checks if there is a child process associated with the client and handles it accordingly.
-		 * It returns a string indicating the result of the handling process.
-		 *
-		 * @param client The client state object for which to check and handle the child process.
-		 * @return A string indicating the result of the handling process.
+		 * @return A pidfd for `pid` that becomes readable when the process exits, -1 if the kernel has none.
+		 */
+		static int openPidFd(pid_t pid);
+
+		/**
+		 * @brief Watches a CGI output pipe or pidfd for reading on behalf of the client `clientFd`.
+		 */
+		bool watchCGI(int cgiFd, int clientFd);
+
+		/**
+		 * @brief Stops watching and closes a CGI pipe or pidfd, and sets it to -1.
+		 */
+		void unwatchCGI(int& cgiFd);
+
+		/**
+		 * @brief Reads the output or reaps the script, depending on which of its descriptors is ready,
+		 * and finishes the response once both happened.
+		 */
+		void handleCGIEvent(int cgiFd, int clientFd);
+
+		/**
+		 * @brief Appends what the script wrote to `cgiOutput`, up to `CGI_READ_LIMIT` bytes per call.
+		 * Closes the pipe at its end.
+		 */
+		void readCGIOutput(ClientState& client);
+
+		/**
+		 * @brief Collects the script's exit status if it exited, without blocking.
+		 */
+		void reapCGI(ClientState& client);
+
+		/**
+		 * @brief Queues the response once the script closed its output and was reaped, then continues
+		 * with the requests pipelined behind it.
+		 */
+		void finishCGI(int fd);
+
+		/**
+		 * @brief Kills the script of a client that timed out or went away and releases its descriptors.
+		 */
+		void stopCGI(int fd);
+
+		/**
+		 * @brief Queues the headers of a CGI response as soon as the script's header block is complete,
+		 * the body is then forwarded as it arrives. A block with an invalid `Status` is answered with 500.
+		 */
+		void startCGIStream(int fd);
+
+		/**
+		 * @brief Queues the output read since the last call, as a chunk for HTTP/1.1 clients, and stops
+		 * reading the pipe while `CGI_BUFFER_LIMIT` bytes wait to be sent.
+		 */
+		void forwardCGIOutput(int fd);
+
+		/**
+		 * @brief Reads the pipe of a paused script again once the client's queue went below half of `CGI_BUFFER_LIMIT`.
 		 */
-		std::string checkAndHandleChildProcess(ClientState& client);
+		void resumeCGI(ClientState& client);
+
+		/**
+		 * @brief Ends a streamed CGI response with the last chunk, or, if the script failed or timed out,
+		 * by closing the connection after the queued output.
+		 */
+		void endCGIStream(int fd, bool complete);
 
 		/**
 		 * @brief Executes a child process for the given client and full path.
@@ -158,6 +356,141 @@ class SocketManager {
 		 */
 		void processCGI(std::string stringCode, int fd);
 
+		/**
+		 * @brief Enables or disables write notifications for a client socket.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 * @param enable True while the client has a response waiting to be sent.
+		 */
+		void watchWrite(int fd, bool enable);
+
+		/**
+		 * @brief Dispatches a ready file descriptor returned by the poller to the matching handlers.
+		 *
+		 * Closes the connection afterwards if one of the handlers flagged it.
+		 *
+		 * @param event The ready file descriptor and its events.
+		 */
+		void handleEvent(const PollerEvent& event);
+
+		/**
+		 * @brief Applies the file changes reported by the content cache's inotify descriptor to both caches.
+		 */
+		void handleFileChanges();
+
+		/**
+		 * @brief Checks the clients whose CGI script has no pidfd for its exit, see `cgiClients`.
+		 *
+		 * Clients whose script finished get their response assigned and are watched for writing again.
+		 */
+		void checkCGIClients();
+
+		/**
+		 * @brief Applies the send and keep-alive timeouts to the clients whose timer expired.
+		 *
+		 * Only expired timers are visited. A client that is still within its limits is armed again.
+		 * A send timeout flags the client with `killTheChild`, which stops a running CGI script.
+		 */
+		void checkTimeouts();
+
+		/**
+		 * @brief Records activity on a client and re-arms its timer.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 */
+		void touchClient(int fd);
+
+		/**
+		 * @brief Arms the timer of a client for its next send or keep-alive deadline.
+		 *
+		 * @param fd The file descriptor of the client socket.
+		 * @param client The state of the client.
+		 */
+		void armTimer(int fd, ClientState& client);
+
+		/**
+		 * @brief Gets the server configuration whose timeouts apply to a client.
+		 *
+		 * Before the `Host` header was parsed this is the default server of the client's port.
+		 */
+		ServerConfig& getTimeoutServer(ClientState& client);
+
+		/**
+		 * @return The timeout for the next wait of the event loop in milliseconds.
+		 */
+		int nextTimeout() const;
+
+		/**
+		 * @brief The readiness based event loop (`poll` or `epoll`).
+		 */
+		void runPoller();
+
+		/**
+		 * @brief Creates the io_uring instance and its receive buffers.
+		 *
+		 * @return False if io_uring is not compiled in or not usable at runtime, the caller then falls back to `runPoller()`.
+		 */
+		bool setupRing();
+
+		/**
+		 * @brief The completion based event loop of the io_uring backend.
+		 *
+		 * Accepts are multishot, receives are multishot into provided buffers and sends are submitted from the
+		 * client's buffer. All submissions of one iteration reach the kernel with a single `io_uring_enter`.
+		 * Received data and finished sends go through the same request handling as the poller backends.
+		 */
+		void runRing();
+
+#ifdef WEBSERV_HAS_IO_URING
+		/**
+		 * @brief Builds the `user_data` of a submission from the operation, the file descriptor and its generation.
+		 *
+		 * The generation changes whenever the file descriptor is closed, so late completions for a
+		 * previous connection with the same number can be recognised and dropped.
+		 */
+		uint64_t ringData(int operation, int fd);
+
+		/**
+		 * @brief Invalidates all submissions that are still in flight for a file descriptor that is about to be closed.
+		 */
+		void retireRingFd(int fd);
+
+		void submitAccept(int serverFd);
+		void submitRecv(int fd);
+
+		/**
+		 * @brief Cancels the multishot recv of a client, it ends with `-ECANCELED`.
+		 */
+		void cancelRecv(int fd);
+
+		/**
+		 * @brief Submits a send of the client's pending responses, unless one is already in flight.
+		 *
+		 * The memory segments at the front of the output queue are sent with one `sendmsg()`. They are left
+		 * in the queue, untouched, until the send completes.
+		 */
+		void submitSend(int fd);
+
+		/**
+		 * @brief Waits for the socket to become writable to send the file body at the front of the client's queue.
+		 *
+		 * The ring has no `sendfile()`, so the body is sent with `sendfile()` from the completion, see `ringWritable()`.
+		 */
+		void submitWritable(int fd);
+		void submitWakeup();
+		void submitFileChanges();
+		void submitCGI(int cgiFd);
+
+		/**
+		 * @brief Dispatches one completion to the matching handler.
+		 */
+		void handleCompletion(const struct io_uring_cqe& cqe);
+		void ringAccepted(int serverFd, int result, unsigned flags);
+		void ringReceived(int fd, int result, unsigned flags);
+		void ringSent(int fd, int result);
+		void ringWritable(int fd, int result);
+#endif
+
 	public:
 		SocketManager(const HTTPConfig& config);
 		~SocketManager();
@@ -178,7 +511,7 @@ class SocketManager {
 		 *
 		 * @param fd The file descriptor to handle the POLLIN event for.
 		 */
-		void pollin(pollfd &fd);
+		void pollin(int fd);
 
 		/**
 		 * @brief Handles the POLLOUT event for a given file descriptor.
@@ -186,27 +519,37 @@ class SocketManager {
 		 * This function is responsible for handling the POLLOUT event for a specific file descriptor.
 		 * It is called when the file descriptor is ready for writing.
 		 *
-		 * @param fd The pollfd structure representing the file descriptor.
+		 * @param fd The file descriptor that is ready for writing.
 		 */
-		void pollout(pollfd &fd);
+		void pollout(int fd);
 
 		/**
 		 * @brief Handles the error event for a given file descriptor.
 		 *
 		 * This function is called when an error event is detected for a file descriptor
-		 * during the polling process. It takes a reference to a `pollfd` structure
-		 * representing the file descriptor that encountered the error.
+		 * during the polling process.
 		 *
-		 * @param fd The `pollfd` structure representing the file descriptor.
+		 * @param fd The file descriptor that encountered the error.
+		 * @param events The `POLLER_*` flags reported for the file descriptor.
 		 */
-		void pollerr(pollfd &fd);
+		void pollerr(int fd, int events);
 
 		/**
 		 * @brief Runs the socket manager. This is the main loop.
 		 * 
 		 * This function is responsible for running the socket manager and handling incoming connections.
+		 * The backend (`poll`, `epoll` or `io_uring`) is chosen by the `event_backend` directive.
 		 */
 		void run();
+
+		/**
+		 * @brief Interrupts a blocking wait in `run()` so it notices that `g_run` was cleared.
+		 *
+		 * Safe to call from another thread or a signal handler.
+		 */
+		void wakeup();
 };
 
+extern volatile sig_atomic_t g_run;
+
 #endif
\ No newline at end of file
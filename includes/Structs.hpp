@@ -5,14 +5,36 @@
 #include <map>
 #include <string>
 #include <ctime>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "RequestParser.hpp"
+#include "Upload.hpp"
+#include "OutputQueue.hpp"
+#include "MimeTypes.hpp"
+#include "CGIHeaders.hpp"
 
 class HTTPRequest;
 class HTTPResponse;
+class ErrorPages;
 
 enum RequestTypes {
 	GET,
 	DELETE,
 	POST,
+	HEAD,
+};
+
+enum EventBackend {
+	BACKEND_POLL,
+	BACKEND_EPOLL,
+	BACKEND_IO_URING,
+};
+
+enum ContentEncoding {
+	ENCODING_IDENTITY,
+	ENCODING_GZIP,
+	ENCODING_DEFLATE,
 };
 
 enum SectionTypes {
@@ -26,6 +48,8 @@ struct LocationConfig {
 	std::vector<RequestTypes> allowedRequestTypes;
 	std::string locationPath;
 	std::string redirection;
+	// `gzip` of the location: 1 on, 0 off, -1 as in the server block
+	int gzip;
 };
 
 struct ServerConfig {
@@ -38,23 +62,59 @@ struct ServerConfig {
 	std::vector<LocationConfig> locations;
 	int keepAliveTimeout;
 	int sendTimeout;
+	bool gzip;
+	// Files configured with `error_page`, by status code, relative to the root directory
+	std::map<int, std::string> errorPageFiles;
+	// The prepared pages of this server block, owned by the socket manager of the event loop
+	const ErrorPages* errorPages;
+};
+
+// The `gzip_*` settings of the http block, see `Compression`
+struct GzipConfig {
+	std::vector<std::string> types;
+	size_t minLength;
+	int level;
+	// Bytes of compressed file variants kept, 0 compresses every time
+	size_t cacheSize;
 };
 
 struct HTTPConfig {
 	std::vector<ServerConfig> serverConfigs;
 	int server_timeout_time;
 	int keepAliveTimeout;
+	EventBackend eventBackend;
+	int workerThreads;
+	int workerProcesses;
+	int acceptBatch;
+	// Entries of the open file cache (0 disables it) and the seconds they stay valid
+	size_t openFileCacheSize;
+	int openFileCacheValid;
+	// Bytes of the static content cache, 0 disables it
+	size_t staticCacheSize;
+	// The built-in types extended by the `types {}` block and `default_type`
+	MimeTypes mimeTypes;
+	GzipConfig gzip;
+};
+
+// A part of a response body that is sent straight from an open file with `sendfile()`, see `HTTPResponse::assignFile()`
+struct FileBody {
+	// Sent before the file range, the part header of a `multipart/byteranges` body
+	std::string header;
+	int fd;
+	off_t offset;
+	size_t remaining;
+	FileBody() : fd(-1), offset(0), remaining(0) {};
 };
 
 struct ClientState {
 	std::string readBuffer;
-	std::string writeBuffer;
-	size_t totalRead;
+	// The responses waiting to be sent, in the order of the requests
+	OutputQueue output;
+	RequestParser parser;
 	size_t contentLength;
-	size_t headerEndIndex;
-	bool headersComplete;
 	bool keepAlive;
-	time_t lastActivity;
+	// Milliseconds on the clock of the event loop, see `TimerWheel::now()`
+	uint64_t lastActivity;
 	bool closeConnection;
 	int serverPort;
 	ServerConfig serverConfig;
@@ -63,20 +123,63 @@ struct ClientState {
 	bool killTheChild;
 	bool hasForked;
 	pid_t childPid;
+	// The script's stdout, the read end is watched by the event loop and -1 once the script closed it
 	int childFd[2];
+	// Becomes readable when the script exits, -1 if the kernel has no pidfd or once the script was reaped
+	int pidFd;
+	// What the script wrote and was not queued yet
+	std::string cgiOutput;
+	bool childExited;
+	// The status from `waitpid()`, -1 if it failed
+	int childStatus;
+	CGIHeaders cgiHeaders;
+	// The headers were sent, the body is forwarded as the script writes it
+	bool cgiStreaming;
+	// The body is framed as chunks, for HTTP/1.1 clients, otherwise the connection is closed after it
+	bool cgiChunked;
+	// The pipe is not read while the client has `CGI_BUFFER_LIMIT` bytes waiting
+	bool cgiPaused;
 	std::string method;
 	std::string body;
+	bool sendInFlight;
+	// The socket is not read while requests wait behind a paused dispatch, see `SocketManager::updateReadPause()`
+	bool readPaused;
+	// A recv is submitted to the ring and did not end yet
+	bool recvArmed;
+	// Whether `gzip` is on for the current request and the encoding its client accepts, kept for a CGI response
+	bool gzip;
+	ContentEncoding encoding;
+	// The upload the body of the current request is streamed into, owned by the connection
+	Upload* upload;
 	ClientState() :
-		totalRead(0),
 		contentLength(0), 
-		headerEndIndex(0), 
-		headersComplete(false), 
+		keepAlive(false),
+		lastActivity(0),
 		closeConnection(false),
 		assignedConfig(false),
 		responding(false),
 		killTheChild(false),
-		hasForked(false)
-	{};
+		hasForked(false),
+		childPid(-1),
+		pidFd(-1),
+		childExited(false),
+		childStatus(0),
+		cgiStreaming(false),
+		cgiChunked(false),
+		cgiPaused(false),
+		sendInFlight(false),
+		readPaused(false),
+		recvArmed(false),
+		gzip(false),
+		encoding(ENCODING_IDENTITY),
+		upload(NULL)
+	{
+		childFd[0] = -1;
+		childFd[1] = -1;
+	};
+	~ClientState() {
+		delete upload;
+	};
 };
 
 #endif
\ No newline at end of file
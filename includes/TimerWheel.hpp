@@ -0,0 +1,96 @@
+#ifndef TIMER_WHEEL_HPP
+# define TIMER_WHEEL_HPP
+
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+// Resolution of the timers in milliseconds
+# define TIMER_TICK 10
+// Number of wheels and slots per wheel, together they cover TIMER_TICK * 64^4 ms (about 46 hours)
+# define TIMER_LEVELS 4
+# define TIMER_SLOT_BITS 6
+# define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+
+/**
+ * @brief Hierarchical timing wheel holding at most one deadline per file descriptor.
+ *
+ * Arming, re-arming and cancelling are constant time, and `expire()` only touches timers that are due
+ * (plus the occasional cascade of a coarser wheel into a finer one). The wheel also owns the event loop's
+ * clock: `updateClock()` reads a coarse monotonic clock once per iteration and `now()` returns the cached value.
+ */
+class TimerWheel {
+	private:
+		struct Timer {
+			uint64_t deadline;
+			int prev;
+			int next;
+			int level;
+			int slot;
+			bool armed;
+			Timer() : deadline(0), prev(-1), next(-1), level(0), slot(0), armed(false) {};
+		};
+
+		std::vector<Timer> timers;
+		int slots[TIMER_LEVELS][TIMER_SLOTS];
+		size_t armedCount;
+		uint64_t currentTime;
+		uint64_t currentTick;
+
+		/**
+		 * @brief Links an armed timer into the slot matching its deadline, relative to `currentTick`.
+		 */
+		void place(int fd);
+		void unlink(int fd);
+
+		/**
+		 * @brief Moves every timer of a slot of a coarse wheel down to the finer wheels.
+		 */
+		void cascade(int level, int slot);
+
+		TimerWheel(const TimerWheel&);
+		TimerWheel& operator=(const TimerWheel&);
+	public:
+		TimerWheel();
+		~TimerWheel();
+
+		/**
+		 * @brief Reads the monotonic clock. Called once per iteration of the event loop.
+		 */
+		void updateClock();
+
+		/**
+		 * @return The cached time of the last `updateClock()` in milliseconds.
+		 */
+		uint64_t now() const;
+
+		/**
+		 * @brief Arms the timer of a file descriptor, replacing its previous deadline.
+		 *
+		 * @param fd The file descriptor the timer belongs to.
+		 * @param deadline The expiry in milliseconds on the clock returned by `now()`.
+		 */
+		void schedule(int fd, uint64_t deadline);
+
+		/**
+		 * @brief Disarms the timer of a file descriptor, if it is armed.
+		 */
+		void cancel(int fd);
+
+		/**
+		 * @brief Disarms all timers that are due at `now()`.
+		 *
+		 * @param expired Filled with the file descriptors of the expired timers.
+		 */
+		void expire(std::vector<int>& expired);
+
+		/**
+		 * @brief Computes how long the event loop may sleep before the next timer needs attention.
+		 *
+		 * @param maxTimeout The timeout to use when no timer is due earlier, -1 for none.
+		 * @return The timeout in milliseconds.
+		 */
+		int nextTimeout(int maxTimeout) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef UPLOAD_HPP
+# define UPLOAD_HPP
+
+#include <string>
+#include <vector>
+#include "BodySink.hpp"
+#include "FileSink.hpp"
+#include "MultipartParser.hpp"
+
+/**
+ * @brief Stores the body of a POST request below the root directory while it is received.
+ *
+ * A multipart/form-data body is split by a `MultipartParser` and every part with a file name is written
+ * to `<uri><file name>`, other bodies are written to `<uri>` itself. Each file goes through a `FileSink`,
+ * so memory use does not depend on the size of the upload. Like before, the upload stops at the first
+ * file that already exists or can not be written.
+ */
+class Upload : public BodySink, public MultipartSink {
+	private:
+		std::string rootDirectory;
+		std::string uri;
+		MultipartParser* multipart;
+		FileSink file;
+		std::string fileUri;
+		std::vector<std::string> savedPaths;
+		int status;
+		std::string location;
+
+		void openFile(const std::string& fileUri);
+		void commitFile();
+		void fail(int status);
+
+		Upload(const Upload&);
+		Upload& operator=(const Upload&);
+	public:
+		/**
+		 * @param rootDirectory The root directory of the server.
+		 * @param uri The request URI, without query string.
+		 * @param contentType The Content-Type of the request.
+		 */
+		Upload(const std::string& rootDirectory, const std::string& uri, const std::string& contentType);
+		~Upload();
+
+		void write(const char* data, size_t length);
+		void beginPart(const MultipartPart& part);
+		void partData(const char* data, size_t length);
+		void endPart();
+
+		/**
+		 * @brief Called once the whole body was received, publishes the last file.
+		 */
+		void finish();
+
+		/**
+		 * @return 201 if every file was stored, 302 for a file that already exists (see `getLocation()`),
+		 * 400 for a malformed multipart body or 500 if a file could not be written.
+		 */
+		int getStatus() const;
+
+		/**
+		 * @return The paths of the stored files.
+		 */
+		const std::vector<std::string>& getSavedPaths() const;
+
+		/**
+		 * @return The URI of the file that already existed.
+		 */
+		const std::string& getLocation() const;
+};
+
+#endif
\ No newline at end of file
@@ -6,6 +6,8 @@
 # include <iostream>
 # include <sstream>
 # include <limits>
+# include <ctime>
+# include <cstring>
 
 # include "Utils.tpp"
 
@@ -35,6 +37,32 @@ std::string trim(const std::string& str);
  */
 bool endsWith(const std::string& fullString, const std::string& ending);
 
+/**
+ * @brief Gets a parameter of a URL query string, e.g. "2" for `page` in "sort=name&page=2".
+ *
+ * @return The raw value, or an empty string if the parameter is missing.
+ */
+std::string getQueryParameter(const std::string& query, const std::string& name);
+
+/**
+ * @brief Formats a time as an HTTP-date (IMF-fixdate), e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+ */
+std::string formatHTTPDate(time_t time);
+
+/**
+ * @brief The current time as an HTTP-date for the `Date` header, formatted at most once per second and thread.
+ *
+ * @return The date, valid until the next call on the same thread.
+ */
+const char* currentHTTPDate();
+
+/**
+ * @brief Parses an HTTP-date in the IMF-fixdate format.
+ *
+ * @return The time, or -1 if `str` is not an IMF-fixdate.
+ */
+time_t parseHTTPDate(const std::string& str);
+
 /**
  * Converts a RequestTypes enum value to its corresponding string representation.
  *
@@ -0,0 +1,78 @@
+#ifndef WORKER_PROCESSES_HPP
+# define WORKER_PROCESSES_HPP
+
+#include <vector>
+#include <ctime>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+# include <sys/prctl.h>
+#endif
+
+#include "Structs.hpp"
+#include "SocketManager.hpp"
+
+// Seconds between two liveness reports of the master process
+# define WORKER_REPORT_INTERVAL 30
+// Workers that die within this many seconds of being started are respawned with a delay
+# define WORKER_RESPAWN_DELAY 1
+// Seconds the master waits for workers to exit on shutdown before killing them
+# define WORKER_SHUTDOWN_TIMEOUT 5
+
+struct WorkerProcess {
+	pid_t pid;
+	time_t startedAt;
+	time_t respawnAt;
+	int restarts;
+	WorkerProcess() : pid(-1), startedAt(0), respawnAt(0), restarts(0) {};
+};
+
+class WorkerProcesses {
+	private:
+		HTTPConfig config;
+		SocketManager socketManager;
+		std::vector<WorkerProcess> workers;
+		time_t lastReport;
+
+		/**
+		 * @brief Forks the worker in the given slot. The child runs the event loop and never returns.
+		 *
+		 * @param index The slot of the worker in `workers`.
+		 * @param signals The signals blocked by the master, unblocked again in the child.
+		 */
+		void spawnWorker(size_t index, sigset_t& signals);
+
+		/**
+		 * @brief Reaps every exited worker and schedules it to be respawned.
+		 */
+		void reapWorkers();
+
+		/**
+		 * @brief Respawns all workers whose respawn time has come.
+		 */
+		void respawnWorkers(sigset_t& signals);
+
+		/**
+		 * @brief Logs pid, uptime and restart count of every worker and checks that it is still alive.
+		 */
+		void reportLiveness();
+
+		/**
+		 * @brief Sends SIGTERM to all workers and waits for them, killing those that do not exit in time.
+		 */
+		void stopWorkers();
+	public:
+		WorkerProcesses(const HTTPConfig& config);
+		~WorkerProcesses();
+
+		/**
+		 * @brief Binds the listeners once, forks `worker_processes` workers and supervises them.
+		 *
+		 * Every worker inherits the listening sockets and runs its own `SocketManager::run()`, so a crash
+		 * only takes down one worker. Dead workers are respawned until SIGINT or SIGTERM is received.
+		 */
+		void run();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef WORKER_THREADS_HPP
+# define WORKER_THREADS_HPP
+
+#include <vector>
+#include <pthread.h>
+#include <signal.h>
+
+#include "Structs.hpp"
+#include "SocketManager.hpp"
+
+class WorkerThreads {
+	private:
+		HTTPConfig config;
+		std::vector<SocketManager*> managers;
+		std::vector<pthread_t> threads;
+		pthread_mutex_t runningMutex;
+		int running;
+
+		/**
+		 * @brief Entry point of a worker thread. Binds the listeners of its `SocketManager` and runs its event loop.
+		 *
+		 * @param arg The `WorkerThreads` instance and worker index, see `WorkerArgs`.
+		 * @return Always NULL.
+		 */
+		static void* workerMain(void* arg);
+
+		/**
+		 * @brief Waits for SIGINT or SIGTERM, or until every worker stopped on its own.
+		 */
+		void waitForShutdown(sigset_t& signals);
+	public:
+		WorkerThreads(const HTTPConfig& config);
+		~WorkerThreads();
+
+		/**
+		 * @brief Starts `worker_threads` threads and blocks until the server is stopped.
+		 *
+		 * Every thread owns a `SocketManager` with its own listening sockets (bound with `SO_REUSEPORT`),
+		 * its own poller and its own client table, so threads never share connection state.
+		 * Signals are blocked in the workers and handled here, the workers are woken up on shutdown.
+		 */
+		void run();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "CGIHeaders.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+CGIHeaders::CGIHeaders() {
+	reset();
+}
+
+CGIHeaders::~CGIHeaders() {}
+
+void CGIHeaders::reset() {
+	this->state = CGI_HEADERS_PENDING;
+	this->statusCode = 200;
+	this->fields.clear();
+	this->bodyOffset = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Parsing                                  */
+/* -------------------------------------------------------------------------- */
+
+CGIHeaderState CGIHeaders::parse(const std::string& output, bool finished) {
+	if (this->state != CGI_HEADERS_PENDING)
+		return this->state;
+	// The block is short, it is parsed again from the start until it is complete
+	this->fields.clear();
+	size_t start = 0;
+	while (true) {
+		size_t end = output.find('\n', start);
+		if (end == std::string::npos) {
+			// A block that is not terminated by an empty line ends with the output
+			if (finished && !this->fields.empty() && start == output.size()) {
+				this->bodyOffset = start;
+				break;
+			}
+			if (finished || output.size() >= CGI_HEADER_LIMIT) {
+				this->fields.clear();
+				this->state = CGI_HEADERS_NONE;
+			}
+			return this->state;
+		}
+		std::string line = output.substr(start, end - start);
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		start = end + 1;
+		if (line.empty()) {
+			this->bodyOffset = start;
+			break;
+		}
+		std::string name;
+		std::string value;
+		if (!parseField(line, name, value)) {
+			this->fields.clear();
+			this->state = CGI_HEADERS_NONE;
+			return this->state;
+		}
+		this->fields.push_back(std::make_pair(name, value));
+	}
+	this->state = CGI_HEADERS_COMPLETE;
+	finish();
+	return this->state;
+}
+
+void CGIHeaders::finish() {
+	bool hasStatus = false;
+	bool hasLocation = false;
+	std::vector<std::pair<std::string, std::string> > kept;
+	for (size_t i = 0; i < this->fields.size(); i++) {
+		const std::string& name = this->fields[i].first;
+		const std::string& value = this->fields[i].second;
+		if (equalsIgnoreCase(name, "Status")) {
+			// "404 Not Found", the reason phrase comes from the server's own table
+			if (value.size() < 3 || !isdigit(value[0]) || !isdigit(value[1]) || !isdigit(value[2])
+				|| (value.size() > 3 && value[3] != ' ')) {
+				this->state = CGI_HEADERS_INVALID;
+				return;
+			}
+			this->statusCode = std::atoi(value.substr(0, 3).c_str());
+			if (this->statusCode < 100 || this->statusCode > 599) {
+				this->state = CGI_HEADERS_INVALID;
+				return;
+			}
+			hasStatus = true;
+			continue;
+		}
+		if (equalsIgnoreCase(name, "Content-Length") || equalsIgnoreCase(name, "Transfer-Encoding")
+			|| equalsIgnoreCase(name, "Connection"))
+			continue;
+		hasLocation = hasLocation || equalsIgnoreCase(name, "Location");
+		kept.push_back(this->fields[i]);
+		// The server looks the type up by this name, e.g. for compression
+		if (equalsIgnoreCase(name, "Content-Type"))
+			kept.back().first = "Content-Type";
+	}
+	if (hasLocation && !hasStatus)
+		this->statusCode = 302;
+	this->fields.swap(kept);
+}
+
+bool CGIHeaders::parseField(const std::string& line, std::string& name, std::string& value) {
+	size_t colon = line.find(':');
+	if (colon == std::string::npos || colon == 0)
+		return false;
+	// The name is a token (RFC 9110, section 5.6.2), a line of HTML or text is not
+	for (size_t i = 0; i < colon; i++) {
+		unsigned char c = line[i];
+		if (!isalnum(c) && !std::strchr("!#$%&'*+-.^_`|~", c))
+			return false;
+	}
+	name = line.substr(0, colon);
+	size_t first = line.find_first_not_of(" \t", colon + 1);
+	size_t last = line.find_last_not_of(" \t");
+	value = first == std::string::npos ? "" : line.substr(first, last - first + 1);
+	return true;
+}
+
+bool CGIHeaders::equalsIgnoreCase(const std::string& a, const char* b) {
+	size_t i = 0;
+	for (; i < a.size() && b[i]; i++) {
+		if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+			return false;
+	}
+	return i == a.size() && b[i] == '\0';
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+CGIHeaderState CGIHeaders::getState() const {
+	return this->state;
+}
+
+int CGIHeaders::getStatusCode() const {
+	return this->statusCode;
+}
+
+const std::vector<std::pair<std::string, std::string> >& CGIHeaders::getFields() const {
+	return this->fields;
+}
+
+size_t CGIHeaders::getBodyOffset() const {
+	return this->bodyOffset;
+}
\ No newline at end of file
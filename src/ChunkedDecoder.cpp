@@ -0,0 +1,152 @@
+#include "ChunkedDecoder.hpp"
+
+#include <algorithm>
+
+ChunkedDecoder::ChunkedDecoder() {
+	reset(static_cast<size_t>(-1));
+}
+
+ChunkedDecoder::~ChunkedDecoder() {}
+
+void ChunkedDecoder::reset(size_t maxBodySize) {
+	this->state = CHUNK_SIZE;
+	this->chunkRemaining = 0;
+	this->sizeDigits = 0;
+	this->lineLength = 0;
+	this->trailerCR = false;
+	this->decodedLength = 0;
+	this->maxBodySize = maxBodySize;
+	this->errorStatus = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Decoding                                  */
+/* -------------------------------------------------------------------------- */
+
+size_t ChunkedDecoder::decode(const char* data, size_t length, std::string& output) {
+	size_t position = 0;
+	while (position < length && this->state != CHUNK_DONE && this->state != CHUNK_ERROR) {
+		if (this->state == CHUNK_DATA) {
+			size_t available = std::min(this->chunkRemaining, length - position);
+			output.append(data + position, available);
+			position += available;
+			this->chunkRemaining -= available;
+			if (this->chunkRemaining == 0)
+				this->state = CHUNK_DATA_CR;
+		} else {
+			consumeFraming(data[position++]);
+		}
+	}
+	return position;
+}
+
+void ChunkedDecoder::consumeFraming(char c) {
+	if (++this->lineLength > CHUNK_LINE_LIMIT)
+		return fail(400);
+	switch (this->state) {
+		case CHUNK_SIZE: {
+			int digit = -1;
+			if (c >= '0' && c <= '9')
+				digit = c - '0';
+			else if (c >= 'a' && c <= 'f')
+				digit = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				digit = c - 'A' + 10;
+			if (digit >= 0) {
+				if (this->chunkRemaining > (static_cast<size_t>(-1) >> 4))
+					return fail(400);
+				this->chunkRemaining = this->chunkRemaining * 16 + digit;
+				this->sizeDigits++;
+				return;
+			}
+			if (this->sizeDigits == 0)
+				return fail(400);
+			if (c == ';' || c == ' ' || c == '\t')
+				this->state = CHUNK_EXTENSION;
+			else if (c == '\r')
+				this->state = CHUNK_SIZE_LF;
+			else if (c == '\n')
+				break;
+			else
+				fail(400);
+			return;
+		}
+		case CHUNK_EXTENSION:
+			if (c == '\r')
+				this->state = CHUNK_SIZE_LF;
+			else if (c == '\n')
+				break;
+			return;
+		case CHUNK_SIZE_LF:
+			if (c != '\n')
+				return fail(400);
+			break;
+		case CHUNK_DATA_CR:
+			if (c == '\r')
+				this->state = CHUNK_DATA_LF;
+			else if (c != '\n')
+				return fail(400);
+			else
+				startChunkSize();
+			return;
+		case CHUNK_DATA_LF:
+			if (c != '\n')
+				return fail(400);
+			startChunkSize();
+			return;
+		case CHUNK_TRAILER:
+			// Trailer fields are skipped, an empty line ends the body
+			if (c == '\n') {
+				if (this->lineLength == 1 || (this->lineLength == 2 && this->trailerCR))
+					this->state = CHUNK_DONE;
+				this->lineLength = 0;
+			}
+			this->trailerCR = (c == '\r');
+			return;
+		default:
+			return;
+	}
+	// The size line is complete
+	this->lineLength = 0;
+	if (this->chunkRemaining == 0) {
+		this->state = CHUNK_TRAILER;
+		this->trailerCR = false;
+		return;
+	}
+	if (this->chunkRemaining > this->maxBodySize - this->decodedLength)
+		return fail(413);
+	this->decodedLength += this->chunkRemaining;
+	this->state = CHUNK_DATA;
+}
+
+void ChunkedDecoder::startChunkSize() {
+	this->state = CHUNK_SIZE;
+	this->chunkRemaining = 0;
+	this->sizeDigits = 0;
+	this->lineLength = 0;
+}
+
+void ChunkedDecoder::fail(int status) {
+	this->errorStatus = status;
+	this->state = CHUNK_ERROR;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+bool ChunkedDecoder::done() const {
+	return this->state == CHUNK_DONE;
+}
+
+bool ChunkedDecoder::failed() const {
+	return this->state == CHUNK_ERROR;
+}
+
+int ChunkedDecoder::getErrorStatus() const {
+	return this->errorStatus;
+}
+
+size_t ChunkedDecoder::getDecodedLength() const {
+	return this->decodedLength;
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "Compression.hpp"
+#include "Utils.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <unistd.h>
+
+// Bytes read from a file and produced by zlib per step
+#define COMPRESSION_BLOCK 65536
+
+namespace {
+	double monotonicSeconds() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec + now.tv_nsec / 1e9;
+	}
+}
+
+Compression::Compression(const GzipConfig& config) :
+	config(config),
+	usedSize(0),
+	hits(0),
+	misses(0),
+	bytesIn(0),
+	bytesOut(0),
+	seconds(0)
+{}
+
+Compression::~Compression() {
+	while (!this->entries.empty())
+		drop(this->entries.begin());
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Negotiation                                */
+/* -------------------------------------------------------------------------- */
+
+ContentEncoding Compression::negotiate(const std::string& acceptEncoding) {
+	double gzip = -1;
+	double deflate = -1;
+	double any = 0;
+	std::istringstream list(acceptEncoding);
+	std::string coding;
+	while (std::getline(list, coding, ',')) {
+		double quality = 1;
+		size_t semicolon = coding.find(';');
+		if (semicolon != std::string::npos) {
+			std::string parameter = trim(coding.substr(semicolon + 1));
+			if (parameter.compare(0, 2, "q=") == 0 || parameter.compare(0, 2, "Q=") == 0)
+				quality = std::strtod(parameter.c_str() + 2, NULL);
+			coding.erase(semicolon);
+		}
+		coding = trim(coding);
+		for (size_t i = 0; i < coding.size(); i++)
+			coding[i] = std::tolower(static_cast<unsigned char>(coding[i]));
+		if (coding == "gzip" || coding == "x-gzip")
+			gzip = quality;
+		else if (coding == "deflate")
+			deflate = quality;
+		else if (coding == "*")
+			any = quality;
+	}
+	// "*" stands for every coding that is not listed (RFC 9110, section 12.5.3)
+	if (gzip < 0)
+		gzip = any;
+	if (deflate < 0)
+		deflate = any;
+	if (gzip > 0 && gzip >= deflate)
+		return ENCODING_GZIP;
+	if (deflate > 0)
+		return ENCODING_DEFLATE;
+	return ENCODING_IDENTITY;
+}
+
+const char* Compression::encodingName(ContentEncoding encoding) {
+	switch (encoding) {
+		case ENCODING_GZIP: return "gzip";
+		case ENCODING_DEFLATE: return "deflate";
+		default: return "identity";
+	}
+}
+
+bool Compression::isCompressibleType(const std::string& contentType) const {
+	size_t end = contentType.find(';');
+	std::string type = trim(contentType.substr(0, end));
+	for (size_t i = 0; i < this->config.types.size(); i++) {
+		if (this->config.types[i] == type || this->config.types[i] == "*")
+			return true;
+	}
+	return false;
+}
+
+bool Compression::isCompressibleLength(size_t length) const {
+	return length >= this->config.minLength;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Compressing                                */
+/* -------------------------------------------------------------------------- */
+
+bool Compression::compress(const std::string& data, ContentEncoding encoding, std::string& out) {
+	z_stream stream;
+	if (!begin(stream, encoding))
+		return false;
+	double start = monotonicSeconds();
+	out.clear();
+	out.reserve(data.size() / 3 + 64);
+	bool done = deflateInto(stream, data.data(), data.size(), true, out);
+	deflateEnd(&stream);
+	this->seconds += monotonicSeconds() - start;
+	if (done) {
+		this->bytesIn += data.size();
+		this->bytesOut += out.size();
+	}
+	return done;
+}
+
+SharedBuffer* Compression::compressFile(const std::string& path, int fd, const struct stat& info, ContentEncoding encoding) {
+	z_stream stream;
+	if (!begin(stream, encoding))
+		return NULL;
+	double start = monotonicSeconds();
+	std::string out;
+	out.reserve(info.st_size / 3 + 64);
+	char block[COMPRESSION_BLOCK];
+	off_t offset = 0;
+	bool done = true;
+	while (done && offset < info.st_size) {
+		ssize_t bytesRead = pread(fd, block, sizeof(block), offset);
+		if (bytesRead <= 0)
+			done = false;
+		else {
+			offset += bytesRead;
+			done = deflateInto(stream, block, bytesRead, offset >= info.st_size, out);
+		}
+	}
+	if (done && info.st_size == 0)
+		done = deflateInto(stream, NULL, 0, true, out);
+	deflateEnd(&stream);
+	this->seconds += monotonicSeconds() - start;
+	if (!done)
+		return NULL;
+	this->misses++;
+	this->bytesIn += info.st_size;
+	this->bytesOut += out.size();
+
+	std::string key = makeKey(path, encoding);
+	std::map<std::string, Entry>::iterator it = this->entries.find(key);
+	if (it != this->entries.end())
+		drop(it);
+	SharedBuffer* data = SharedBuffer::create(out);
+	if (data->str().size() > this->config.cacheSize)
+		return data;
+	while (this->usedSize + data->str().size() > this->config.cacheSize)
+		drop(this->entries.find(this->recent.back()));
+	this->usedSize += data->str().size();
+	this->recent.push_front(key);
+	Entry& entry = this->entries[key];
+	entry.device = info.st_dev;
+	entry.inode = info.st_ino;
+	entry.size = info.st_size;
+	entry.modified = info.st_mtim;
+	entry.data = data->retain();
+	entry.recent = this->recent.begin();
+	return data;
+}
+
+bool Compression::begin(z_stream& stream, ContentEncoding encoding) const {
+	std::memset(&stream, 0, sizeof(stream));
+	// 15 window bits give the zlib format of "deflate", +16 the gzip format
+	int windowBits = encoding == ENCODING_GZIP ? 15 + 16 : 15;
+	return deflateInit2(&stream, this->config.level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+bool Compression::deflateInto(z_stream& stream, const char* data, size_t length, bool finish, std::string& out) {
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	stream.avail_in = length;
+	int result;
+	do {
+		size_t used = out.size();
+		out.resize(used + COMPRESSION_BLOCK);
+		stream.next_out = reinterpret_cast<Bytef*>(&out[used]);
+		stream.avail_out = COMPRESSION_BLOCK;
+		result = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+		out.resize(used + COMPRESSION_BLOCK - stream.avail_out);
+		if (result == Z_STREAM_ERROR)
+			return false;
+	} while (stream.avail_out == 0 || (finish && result != Z_STREAM_END));
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Cache                                   */
+/* -------------------------------------------------------------------------- */
+
+SharedBuffer* Compression::lookup(const std::string& path, ContentEncoding encoding, const struct stat& info) {
+	std::map<std::string, Entry>::iterator it = this->entries.find(makeKey(path, encoding));
+	if (it == this->entries.end())
+		return NULL;
+	const Entry& entry = it->second;
+	if (entry.device != info.st_dev || entry.inode != info.st_ino || entry.size != info.st_size
+		|| entry.modified.tv_sec != info.st_mtim.tv_sec || entry.modified.tv_nsec != info.st_mtim.tv_nsec) {
+		drop(it);
+		return NULL;
+	}
+	this->hits++;
+	this->recent.splice(this->recent.begin(), this->recent, it->second.recent);
+	return entry.data->retain();
+}
+
+void Compression::drop(std::map<std::string, Entry>::iterator it) {
+	this->usedSize -= it->second.data->str().size();
+	// Responses that still send the variant keep their own reference
+	it->second.data->release();
+	this->recent.erase(it->second.recent);
+	this->entries.erase(it);
+}
+
+std::string Compression::makeKey(const std::string& path, ContentEncoding encoding) {
+	return std::string(encodingName(encoding)) + " " + path;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+size_t Compression::getHits() const {
+	return this->hits;
+}
+
+size_t Compression::getMisses() const {
+	return this->misses;
+}
+
+size_t Compression::getBytesIn() const {
+	return this->bytesIn;
+}
+
+size_t Compression::getBytesOut() const {
+	return this->bytesOut;
+}
+
+double Compression::getSeconds() const {
+	return this->seconds;
+}
\ No newline at end of file
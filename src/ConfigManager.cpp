@@ -3,6 +3,23 @@
 
 ConfigManager::ConfigManager() {
 	this->httpConfig.server_timeout_time = -1;
+	this->httpConfig.workerThreads = 1;
+	this->httpConfig.workerProcesses = 1;
+	this->httpConfig.acceptBatch = 64;
+	this->httpConfig.openFileCacheSize = 0;
+	this->httpConfig.openFileCacheValid = 5;
+	this->httpConfig.staticCacheSize = 8388608;
+	const char* gzipTypes[] = {"text/html", "text/css", "text/plain", "text/xml", "text/javascript",
+		"application/javascript", "application/json", "image/svg+xml"};
+	this->httpConfig.gzip.types.assign(gzipTypes, gzipTypes + sizeof(gzipTypes) / sizeof(gzipTypes[0]));
+	this->httpConfig.gzip.minLength = 256;
+	this->httpConfig.gzip.level = 6;
+	this->httpConfig.gzip.cacheSize = 8388608;
+#ifdef WEBSERV_HAS_EPOLL
+	this->httpConfig.eventBackend = BACKEND_EPOLL;
+#else
+	this->httpConfig.eventBackend = BACKEND_POLL;
+#endif
 }
 
 ConfigManager::~ConfigManager() {}
@@ -36,6 +53,10 @@ void ConfigManager::parseConfigFile(std::string configFilePath) {
 void ConfigManager::initServerConfig(ServerConfig& serverConfig) {
 	serverConfig.clientMaxBodySize = 100;
 	serverConfig.directoryListing = false;
+	serverConfig.keepAliveTimeout = 75;
+	serverConfig.sendTimeout = 60;
+	serverConfig.errorPages = NULL;
+	serverConfig.gzip = false;
 
 	this->required.clear();
 	this->defined.clear();
@@ -68,6 +89,80 @@ void ConfigManager::parseHttpSection(std::ifstream& configFile, std::string& lin
 			if (value.empty())
 				throw std::runtime_error("Value is missing for 'server_timeout_time'");
 			this->httpConfig.server_timeout_time = convertStringToInt(value);
+		} else if (key == "event_backend") {
+			if (value == "poll")
+				this->httpConfig.eventBackend = BACKEND_POLL;
+			else if (value == "epoll")
+				this->httpConfig.eventBackend = BACKEND_EPOLL;
+			else if (value == "io_uring")
+				this->httpConfig.eventBackend = BACKEND_IO_URING;
+			else
+				throw std::runtime_error("Unknown value for 'event_backend': " + value);
+		} else if (key == "worker_threads") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'worker_threads'");
+			if (value == "auto")
+				this->httpConfig.workerThreads = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+			else
+				this->httpConfig.workerThreads = convertStringToInt(value);
+			if (this->httpConfig.workerThreads < 1)
+				throw std::runtime_error("'worker_threads' must be at least 1");
+		} else if (key == "worker_processes") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'worker_processes'");
+			if (value == "auto")
+				this->httpConfig.workerProcesses = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+			else
+				this->httpConfig.workerProcesses = convertStringToInt(value);
+			if (this->httpConfig.workerProcesses < 1)
+				throw std::runtime_error("'worker_processes' must be at least 1");
+		} else if (key == "accept_batch") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'accept_batch'");
+			this->httpConfig.acceptBatch = convertStringToInt(value);
+			if (this->httpConfig.acceptBatch < 1)
+				throw std::runtime_error("'accept_batch' must be at least 1");
+		} else if (key == "open_file_cache") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'open_file_cache'");
+			this->httpConfig.openFileCacheSize = value == "off" ? 0 : convertStringToInt(value);
+		} else if (key == "open_file_cache_valid") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'open_file_cache_valid'");
+			this->httpConfig.openFileCacheValid = convertStringToInt(value);
+		} else if (key == "static_cache_size") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'static_cache_size'");
+			this->httpConfig.staticCacheSize = value == "off" ? 0 : convertStringToInt(value);
+		} else if (key == "gzip_types") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'gzip_types'");
+			// text/html is always compressed, like in nginx
+			this->httpConfig.gzip.types.assign(1, "text/html");
+			std::istringstream iss(value);
+			std::string type;
+			while (iss >> type)
+				this->httpConfig.gzip.types.push_back(type);
+		} else if (key == "gzip_min_length") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'gzip_min_length'");
+			this->httpConfig.gzip.minLength = convertStringToInt(value);
+		} else if (key == "gzip_comp_level") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'gzip_comp_level'");
+			this->httpConfig.gzip.level = convertStringToInt(value);
+			if (this->httpConfig.gzip.level < 1 || this->httpConfig.gzip.level > 9)
+				throw std::runtime_error("'gzip_comp_level' must be between 1 and 9");
+		} else if (key == "gzip_cache_size") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'gzip_cache_size'");
+			this->httpConfig.gzip.cacheSize = value == "off" ? 0 : convertStringToInt(value);
+		} else if (key == "default_type") {
+			if (value.empty())
+				throw std::runtime_error("Value is missing for 'default_type'");
+			this->httpConfig.mimeTypes.setDefaultType(value);
+		} else if (line == "types {") {
+			parseTypesSection(configFile, line);
 		} else if (line == "server {") {
 			ServerConfig serverConfig;
 			initServerConfig(serverConfig);
@@ -79,6 +174,35 @@ void ConfigManager::parseHttpSection(std::ifstream& configFile, std::string& lin
 	}
 }
 
+/* -------------------------------------------------------------------------- */
+/*                              Handle Types Block                            */
+/* -------------------------------------------------------------------------- */
+
+void ConfigManager::parseTypesSection(std::ifstream& configFile, std::string& line) {
+	while (true) {
+		if (!getline(configFile, line))
+			throw std::runtime_error("Configuration file is missing closing brace '}' for a section");
+		line = trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+		if (line == "}")
+			break;
+		// nginx style lines are accepted as they are: "image/webp webp;"
+		if (line[line.size() - 1] == ';')
+			line.erase(line.size() - 1);
+		std::istringstream iss(line);
+		std::string type, extension;
+		iss >> type;
+		size_t extensions = 0;
+		while (iss >> extension) {
+			this->httpConfig.mimeTypes.add(extension[0] == '.' ? extension.substr(1) : extension, type);
+			extensions++;
+		}
+		if (extensions == 0)
+			throw std::runtime_error("Missing extensions for MIME type: " + line);
+	}
+}
+
 /* -------------------------------------------------------------------------- */
 /*                             Handle Server Block                            */
 /* -------------------------------------------------------------------------- */
@@ -97,6 +221,7 @@ void ConfigManager::parseServerSection(std::ifstream& configFile, std::string& l
 			break;
 		} else if (line.find("location") == 0) {
 			LocationConfig locConfig;
+			locConfig.gzip = -1;
 			parseLocationSection(configFile, line, locConfig);
 			serverConfig.locations.push_back(locConfig);
 		} else {
@@ -118,6 +243,23 @@ void ConfigManager::handleServerDirective(std::string& line, ServerConfig& serve
 
 	if (key.empty() || value.empty())
 		throw std::runtime_error("Could not find key or value for Server directive: " + line);
+	// Can be repeated, every line maps one or more status codes to a page: error_page 404 405 /errors/40x.html
+	if (key == "error_page") {
+		std::istringstream iss(value);
+		std::vector<std::string> parts;
+		std::string part;
+		while (iss >> part)
+			parts.push_back(part);
+		if (parts.size() < 2 || parts.back()[0] != '/')
+			throw std::runtime_error("Invalid error_page, expected status codes followed by a path: " + line);
+		for (size_t i = 0; i + 1 < parts.size(); i++) {
+			int statusCode = convertStringToInt(parts[i]);
+			if (statusCode < 300 || statusCode > 599)
+				throw std::runtime_error("Invalid status code for error_page: " + parts[i]);
+			serverConfig.errorPageFiles[statusCode] = parts.back();
+		}
+		return;
+	}
 	if (std::find(this->defined.begin(), this->defined.end(), key) != this->defined.end())
 		throw std::runtime_error("Duplicate key found: " + key);
 	if (key == "index") {
@@ -136,6 +278,8 @@ void ConfigManager::handleServerDirective(std::string& line, ServerConfig& serve
 		serverConfig.rootDirectory = value;
 	} else if (key == "directory_listing") {
 		serverConfig.directoryListing = (value == "true");
+	} else if (key == "gzip") {
+		serverConfig.gzip = parseSwitch(key, value);
 	} else {
 		throw std::runtime_error("Unknown server key: " + key);
 	}
@@ -171,6 +315,8 @@ void ConfigManager::parseLocationSection(std::ifstream& configFile, std::string&
 				} 
 			} else if (key == "redirection") {
 				locConfig.redirection = value;
+			} else if (key == "gzip") {
+				locConfig.gzip = parseSwitch(key, value);
 			} else {
 				throw std::runtime_error("Unknown key in Location section: " + key);
 			}
@@ -198,6 +344,12 @@ void ConfigManager::checkLocationPath(std::string& line, LocationConfig& locConf
 	}
 }
 
+bool ConfigManager::parseSwitch(const std::string& key, const std::string& value) {
+	if (value != "on" && value != "off")
+		throw std::runtime_error("'" + key + "' must be 'on' or 'off': " + value);
+	return value == "on";
+}
+
 /* -------------------------------------------------------------------------- */
 /*                               Validate Config                              */
 /* -------------------------------------------------------------------------- */
@@ -208,4 +360,16 @@ void ConfigManager::validateConfiguration() {
 	if (this->httpConfig.serverConfigs.size() == 0) {
 		throw std::runtime_error("Http config missing required 'server'");
 	}
+	if (this->httpConfig.workerThreads > 1 && this->httpConfig.workerProcesses > 1)
+		throw std::runtime_error("'worker_threads' and 'worker_processes' cannot be combined");
+	struct rlimit limit;
+	if (this->httpConfig.openFileCacheSize > 0 && getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+		size_t loops = this->httpConfig.workerThreads * this->httpConfig.workerProcesses;
+		size_t perLoop = limit.rlim_cur / OPEN_FILE_CACHE_SHARE / loops;
+		if (this->httpConfig.openFileCacheSize > perLoop) {
+			WARNING("'open_file_cache' lowered to " << perLoop << " entries per event loop to stay within the "
+				<< limit.rlim_cur << " file descriptor limit");
+			this->httpConfig.openFileCacheSize = perLoop;
+		}
+	}
 }
@@ -0,0 +1,59 @@
+#include "ConnectionTable.hpp"
+
+ConnectionTable::ConnectionTable() {}
+
+ConnectionTable::~ConnectionTable() {
+	for (size_t i = 0; i < this->active.size(); i++)
+		delete this->slots[this->active[i]].state;
+}
+
+ClientState& ConnectionTable::insert(int fd) {
+	if (static_cast<size_t>(fd) >= this->slots.size())
+		this->slots.resize(fd + 1);
+	Slot& slot = this->slots[fd];
+	if (slot.state) {
+		// A fresh state instead of assigning one, the old one may own an upload
+		delete slot.state;
+		slot.state = new ClientState();
+		return *slot.state;
+	}
+	slot.state = new ClientState();
+	slot.position = this->active.size();
+	this->active.push_back(fd);
+	return *slot.state;
+}
+
+ClientState* ConnectionTable::find(int fd) const {
+	if (fd < 0 || static_cast<size_t>(fd) >= this->slots.size())
+		return NULL;
+	return this->slots[fd].state;
+}
+
+ClientState& ConnectionTable::operator[](int fd) {
+	ClientState* state = find(fd);
+	return state ? *state : insert(fd);
+}
+
+void ConnectionTable::erase(int fd) {
+	if (!find(fd))
+		return;
+	Slot& slot = this->slots[fd];
+	int last = this->active.back();
+	this->active[slot.position] = last;
+	this->slots[last].position = slot.position;
+	this->active.pop_back();
+	delete slot.state;
+	slot.state = NULL;
+}
+
+size_t ConnectionTable::size() const {
+	return this->active.size();
+}
+
+bool ConnectionTable::empty() const {
+	return this->active.empty();
+}
+
+int ConnectionTable::fdAt(size_t index) const {
+	return this->active[index];
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "ContentCache.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+// Everything that can change or replace a file below a watched directory, or the directory itself
+#define CONTENT_CACHE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM \
+	| IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+ContentCache::ContentCache(size_t maxSize) :
+	maxSize(maxSize),
+	usedSize(0),
+	notifyFd(-1),
+	hits(0),
+	misses(0),
+	evictions(0)
+{}
+
+void ContentCache::start() {
+	if (this->maxSize == 0 || this->notifyFd != -1)
+		return;
+	this->notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (this->notifyFd == -1) {
+		WARNING("inotify is unavailable, the static content cache is disabled");
+		this->maxSize = 0;
+	}
+}
+
+ContentCache::~ContentCache() {
+	while (!this->entries.empty())
+		drop(this->entries.begin());
+	if (this->notifyFd != -1)
+		close(this->notifyFd);
+}
+
+std::string ContentCache::normalize(const std::string& path) {
+	std::string normalized;
+	for (size_t i = 0; i < path.size(); i++) {
+		if (path[i] != '/' || normalized.empty() || normalized[normalized.size() - 1] != '/')
+			normalized += path[i];
+	}
+	if (normalized.size() > 1 && normalized[normalized.size() - 1] == '/')
+		normalized.erase(normalized.size() - 1);
+	return normalized;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Entries                                  */
+/* -------------------------------------------------------------------------- */
+
+SharedBuffer* ContentCache::lookup(const std::string& path, ContentEncoding encoding) {
+	if (this->notifyFd == -1)
+		return NULL;
+	std::map<std::string, Entry>::iterator it = this->entries.find(makeKey(normalize(path), encoding));
+	if (it == this->entries.end()) {
+		this->misses++;
+		return NULL;
+	}
+	this->hits++;
+	this->recent.splice(this->recent.begin(), this->recent, it->second.recent);
+	return it->second.response;
+}
+
+bool ContentCache::watch(const std::string& path) {
+	if (this->notifyFd == -1)
+		return false;
+	std::string normalized = normalize(path);
+	size_t slash = normalized.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : normalized.substr(0, std::max(slash, static_cast<size_t>(1)));
+	// Adding a watch for a directory that is already watched returns its existing descriptor
+	int wd = inotify_add_watch(this->notifyFd, directory.c_str(), CONTENT_CACHE_EVENTS);
+	if (wd == -1)
+		return false;
+	if (this->watches.find(wd) == this->watches.end())
+		this->watches[wd] = directory;
+	return true;
+}
+
+SharedBuffer* ContentCache::insert(const std::string& path, ContentEncoding encoding, const std::string& source, std::string& response) {
+	if (this->notifyFd == -1 || response.size() > std::min(this->maxSize, static_cast<size_t>(STATIC_CACHE_MAX_ENTRY)))
+		return NULL;
+	std::string normalized = normalize(path);
+	std::string key = makeKey(normalized, encoding);
+	std::map<std::string, Entry>::iterator it = this->entries.find(key);
+	if (it != this->entries.end())
+		drop(it);
+	while (this->usedSize + response.size() > this->maxSize) {
+		drop(this->entries.find(this->recent.back()));
+		this->evictions++;
+	}
+	this->usedSize += response.size();
+	this->recent.push_front(key);
+	Entry& entry = this->entries[key];
+	entry.response = SharedBuffer::create(response);
+	entry.path = normalized;
+	entry.source = normalize(source);
+	entry.recent = this->recent.begin();
+	return entry.response;
+}
+
+void ContentCache::invalidate(const std::string& path) {
+	std::string normalized = normalize(path);
+	for (std::map<std::string, Entry>::iterator it = this->entries.begin(); it != this->entries.end();) {
+		std::map<std::string, Entry>::iterator current = it++;
+		if (isBelow(current->second.path, normalized) || isBelow(current->second.source, normalized))
+			drop(current);
+	}
+}
+
+void ContentCache::drop(std::map<std::string, Entry>::iterator it) {
+	this->usedSize -= it->second.response->str().size();
+	// Connections that still send the response keep their own reference
+	it->second.response->release();
+	this->recent.erase(it->second.recent);
+	this->entries.erase(it);
+}
+
+bool ContentCache::isBelow(const std::string& path, const std::string& directory) {
+	return path.compare(0, directory.size(), directory) == 0
+		&& (path.size() == directory.size() || path[directory.size()] == '/');
+}
+
+std::string ContentCache::makeKey(const std::string& path, ContentEncoding encoding) {
+	return std::string(1, static_cast<char>('0' + encoding)) + " " + path;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   inotify                                  */
+/* -------------------------------------------------------------------------- */
+
+int ContentCache::getNotifyFd() const {
+	return this->notifyFd;
+}
+
+void ContentCache::processEvents(std::vector<std::string>& changed) {
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+	while ((length = read(this->notifyFd, buffer, sizeof(buffer))) > 0) {
+		const struct inotify_event* event;
+		for (char* next = buffer; next < buffer + length; next += sizeof(struct inotify_event) + event->len) {
+			event = reinterpret_cast<const struct inotify_event*>(next);
+			// Events were lost, everything below a watched directory may have changed
+			if (event->mask & IN_Q_OVERFLOW) {
+				for (std::map<int, std::string>::iterator it = this->watches.begin(); it != this->watches.end(); ++it) {
+					invalidate(it->second);
+					changed.push_back(it->second);
+				}
+				continue;
+			}
+			std::map<int, std::string>::iterator watch = this->watches.find(event->wd);
+			if (watch == this->watches.end())
+				continue;
+			std::string path = watch->second;
+			if (event->len > 0)
+				path += "/" + std::string(event->name);
+			invalidate(path);
+			changed.push_back(path);
+			if (event->mask & IN_IGNORED)
+				this->watches.erase(watch);
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+size_t ContentCache::getHits() const {
+	return this->hits;
+}
+
+size_t ContentCache::getMisses() const {
+	return this->misses;
+}
+
+size_t ContentCache::getEvictions() const {
+	return this->evictions;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "DirectoryCache.hpp"
+
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+	bool compareName(const DirectoryCache::Entry& a, const DirectoryCache::Entry& b) {
+		return a.name < b.name;
+	}
+
+	// Ties keep the name order, the sort is stable
+	struct CompareBy {
+		const std::vector<DirectoryCache::Entry>& entries;
+		DirectorySort sort;
+		CompareBy(const std::vector<DirectoryCache::Entry>& entries, DirectorySort sort) : entries(entries), sort(sort) {};
+		bool operator()(size_t a, size_t b) const {
+			if (sort == SORT_SIZE)
+				return entries[a].size < entries[b].size;
+			return entries[a].modified < entries[b].modified;
+		}
+	};
+}
+
+DirectoryCache::DirectoryCache() {}
+
+DirectoryCache::~DirectoryCache() {}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Lookup                                   */
+/* -------------------------------------------------------------------------- */
+
+DirectoryCache::Listing* DirectoryCache::lookup(const std::string& path) {
+	struct stat info;
+	std::map<std::string, Listing>::iterator it = this->listings.find(path);
+	if (stat(path.c_str(), &info) == -1 || !S_ISDIR(info.st_mode)) {
+		if (it != this->listings.end())
+			drop(it);
+		return NULL;
+	}
+	if (it != this->listings.end()) {
+		const Listing& listing = it->second;
+		if (listing.device == info.st_dev && listing.inode == info.st_ino && listing.modified.tv_sec == info.st_mtim.tv_sec
+			&& listing.modified.tv_nsec == info.st_mtim.tv_nsec) {
+			this->recent.splice(this->recent.begin(), this->recent, it->second.recent);
+			return &it->second;
+		}
+		drop(it);
+	}
+	Listing listing;
+	if (!load(path, listing))
+		return NULL;
+	if (this->listings.size() >= DIRECTORY_CACHE_SIZE)
+		drop(this->listings.find(this->recent.back()));
+	it = this->listings.insert(std::make_pair(path, Listing())).first;
+	it->second.entries.swap(listing.entries);
+	it->second.device = listing.device;
+	it->second.inode = listing.inode;
+	it->second.modified = listing.modified;
+	this->recent.push_front(path);
+	it->second.recent = this->recent.begin();
+	return &it->second;
+}
+
+const std::vector<size_t>& DirectoryCache::sorted(Listing& listing, DirectorySort sort) {
+	std::vector<size_t>& order = listing.orders[sort];
+	if (order.size() != listing.entries.size()) {
+		order.resize(listing.entries.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		// The entries themselves are in name order
+		if (sort != SORT_NAME)
+			std::stable_sort(order.begin(), order.end(), CompareBy(listing.entries, sort));
+	}
+	return order;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Entries                                  */
+/* -------------------------------------------------------------------------- */
+
+bool DirectoryCache::load(const std::string& path, Listing& listing) {
+	DIR* dir = opendir(path.c_str());
+	if (dir == NULL)
+		return false;
+	struct stat info;
+	// Read before the entries, a change while they are read makes the next lookup read them again
+	if (fstat(dirfd(dir), &info) == -1) {
+		closedir(dir);
+		return false;
+	}
+	listing.device = info.st_dev;
+	listing.inode = info.st_ino;
+	listing.modified = info.st_mtim;
+	struct dirent* dirEntry;
+	while ((dirEntry = readdir(dir)) != NULL) {
+		if (dirEntry->d_name[0] == '.')
+			continue;
+		Entry entry;
+		entry.name = dirEntry->d_name;
+		entry.directory = false;
+		entry.size = 0;
+		entry.modified = 0;
+		if (fstatat(dirfd(dir), dirEntry->d_name, &info, 0) == 0) {
+			entry.directory = S_ISDIR(info.st_mode);
+			entry.size = info.st_size;
+			entry.modified = info.st_mtime;
+		}
+		listing.entries.push_back(entry);
+	}
+	closedir(dir);
+	std::sort(listing.entries.begin(), listing.entries.end(), compareName);
+	return true;
+}
+
+void DirectoryCache::drop(std::map<std::string, Listing>::iterator it) {
+	this->recent.erase(it->second.recent);
+	this->listings.erase(it);
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "EpollPoller.hpp"
+
+#ifdef WEBSERV_HAS_EPOLL
+
+#include <unistd.h>
+
+# define EPOLL_MAX_EVENTS 1024
+
+EpollPoller::EpollPoller(): epollFd(epoll_create1(EPOLL_CLOEXEC)), events(EPOLL_MAX_EVENTS) {}
+
+EpollPoller::~EpollPoller() {
+	if (this->epollFd >= 0)
+		close(this->epollFd);
+}
+
+bool EpollPoller::isValid() const {
+	return this->epollFd >= 0;
+}
+
+uint32_t EpollPoller::toEpollEvents(int fd, int events) const {
+	uint32_t mask = 0;
+	if (events & POLLER_READ)
+		mask |= EPOLLIN | EPOLLRDHUP;
+	if (events & POLLER_WRITE)
+		mask |= EPOLLOUT;
+	if (static_cast<size_t>(fd) < this->edgeTriggered.size() && this->edgeTriggered[fd])
+		mask |= EPOLLET;
+	return mask;
+}
+
+bool EpollPoller::add(int fd, int events, bool edgeTriggered) {
+	if (static_cast<size_t>(fd) >= this->edgeTriggered.size())
+		this->edgeTriggered.resize(fd + 1, false);
+	this->edgeTriggered[fd] = edgeTriggered;
+	struct epoll_event event;
+	event.events = toEpollEvents(fd, events);
+#ifdef EPOLLEXCLUSIVE
+	// EPOLLEXCLUSIVE is only accepted together with EPOLLIN, EPOLLOUT and EPOLLET
+	if (events & POLLER_EXCLUSIVE)
+		event.events = (event.events & ~EPOLLRDHUP) | EPOLLEXCLUSIVE;
+#endif
+	event.data.fd = fd;
+	return epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool EpollPoller::modify(int fd, int events) {
+	struct epoll_event event;
+	event.events = toEpollEvents(fd, events);
+	event.data.fd = fd;
+	return epoll_ctl(this->epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void EpollPoller::remove(int fd) {
+	epoll_ctl(this->epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int EpollPoller::wait(std::vector<PollerEvent>& ready, int timeout) {
+	ready.clear();
+	int count = epoll_wait(this->epollFd, &this->events[0], this->events.size(), timeout);
+	if (count < 0)
+		return -1;
+	for (int i = 0; i < count; i++) {
+		uint32_t revents = this->events[i].events;
+		PollerEvent event = {this->events[i].data.fd, 0};
+		if (revents & (EPOLLIN | EPOLLRDHUP))
+			event.events |= POLLER_READ;
+		if (revents & EPOLLOUT)
+			event.events |= POLLER_WRITE;
+		if (revents & EPOLLERR)
+			event.events |= POLLER_ERROR;
+		if (revents & EPOLLHUP)
+			event.events |= POLLER_HANGUP;
+		ready.push_back(event);
+	}
+	return count;
+}
+
+bool EpollPoller::isEdgeTriggered() const {
+	return true;
+}
+
+const char* EpollPoller::name() const {
+	return "epoll";
+}
+
+#endif
\ No newline at end of file
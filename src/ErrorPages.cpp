@@ -0,0 +1,81 @@
+#include "ErrorPages.hpp"
+#include "HTTPResponse.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+#include <sstream>
+
+ErrorPages::ErrorPages() {
+	addBuiltinPages();
+}
+
+ErrorPages::ErrorPages(const ServerConfig& serverConfig) {
+	addBuiltinPages();
+	for (std::map<int, std::string>::const_iterator it = serverConfig.errorPageFiles.begin(); it != serverConfig.errorPageFiles.end(); ++it) {
+		std::string path = serverConfig.rootDirectory + it->second;
+		std::ifstream file(path.c_str(), std::ios::binary);
+		std::ostringstream content;
+		if (!file.is_open() || !(content << file.rdbuf())) {
+			WARNING("Could not read error_page '" << path << "' for " << it->first << ", using the built-in page");
+			continue;
+		}
+		Page& page = this->pages[it->first];
+		page.head = content.str();
+		page.tail.clear();
+		page.configured = true;
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Pages                                   */
+/* -------------------------------------------------------------------------- */
+
+void ErrorPages::addBuiltinPages() {
+	const std::map<int, std::string>& statusCodes = HTTPResponse::getStatusCodes();
+	for (std::map<int, std::string>::const_iterator it = statusCodes.begin(); it != statusCodes.end(); ++it)
+		this->pages[it->first] = makePage(it->first);
+}
+
+ErrorPages::Page ErrorPages::makePage(int statusCode) {
+	std::string code = ::toString(statusCode);
+	const std::map<int, std::string>& statusCodes = HTTPResponse::getStatusCodes();
+	std::map<int, std::string>::const_iterator reason = statusCodes.find(statusCode);
+	std::string codeMessage = reason != statusCodes.end() ? reason->second : "Unknown Code In Map";
+	Page page;
+	page.head = "<!DOCTYPE html>"
+		"<html lang=\"en\">"
+		"<head>"
+		"<meta charset=\"UTF-8\">"
+		"<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
+		"<title>Webserv - " + code + "</title>"
+		"<link rel=\"stylesheet\" href=\"\\styles.css\">"
+		"<link rel=\"icon\" type=\"image/x-icon\" href=\"favicon.ico\">"
+		"</head>"
+		"<body class=\"background\">"
+		"<div class=\"error\">" + code + " - " + codeMessage + "</div>"
+		"<hr>"
+		"<div class=\"info\">";
+	page.tail = "</div>"
+		"<button onclick=\"window.history.back()\" class=\"back-button\">Back</button>"
+		"</body>"
+		"</html>";
+	return page;
+}
+
+void ErrorPages::render(int statusCode, const std::string& message, std::string& body) const {
+	std::map<int, Page>::const_iterator it = this->pages.find(statusCode);
+	if (it != this->pages.end())
+		renderPage(it->second, message, body);
+	else
+		renderPage(makePage(statusCode), message, body);
+}
+
+void ErrorPages::renderPage(const Page& page, const std::string& message, std::string& body) {
+	if (page.configured) {
+		body = page.head;
+		return;
+	}
+	body.clear();
+	body.reserve(page.head.size() + message.size() + page.tail.size());
+	body.append(page.head).append(message).append(page.tail);
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "FileCache.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileCache::FileCache(size_t maxEntries, int valid, const MimeTypes& mimeTypes) :
+	maxEntries(maxEntries),
+	valid(valid),
+	mimeTypes(mimeTypes)
+{}
+
+FileCache::~FileCache() {
+	while (!this->entries.empty())
+		drop(this->entries.begin());
+	closeEntry(this->uncached);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Lookup                                   */
+/* -------------------------------------------------------------------------- */
+
+const FileCache::Entry& FileCache::lookup(const std::string& path, bool open) {
+	if (this->maxEntries == 0) {
+		closeEntry(this->uncached);
+		this->uncached.error = ENOENT;
+		this->uncached.contentType = &this->mimeTypes.resolve(path);
+		refresh(path, this->uncached);
+		if (open)
+			openEntry(path, this->uncached);
+		return this->uncached;
+	}
+	std::map<std::string, Entry>::iterator it = this->entries.find(path);
+	if (it == this->entries.end()) {
+		if (this->entries.size() >= this->maxEntries)
+			drop(this->entries.find(this->recent.back()));
+		it = this->entries.insert(std::make_pair(path, Entry())).first;
+		this->recent.push_front(path);
+		it->second.recent = this->recent.begin();
+		it->second.error = ENOENT;
+		it->second.contentType = &this->mimeTypes.resolve(path);
+		refresh(path, it->second);
+	} else {
+		this->recent.splice(this->recent.begin(), this->recent, it->second.recent);
+		if (now() >= it->second.validUntil)
+			refresh(path, it->second);
+	}
+	if (open)
+		openEntry(path, it->second);
+	return it->second;
+}
+
+void FileCache::invalidate(const std::string& path) {
+	std::map<std::string, Entry>::iterator it = this->entries.lower_bound(path);
+	while (it != this->entries.end() && it->first.compare(0, path.size(), path) == 0) {
+		std::map<std::string, Entry>::iterator current = it++;
+		if (current->first.size() == path.size() || current->first[path.size()] == '/')
+			drop(current);
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Entries                                  */
+/* -------------------------------------------------------------------------- */
+
+void FileCache::refresh(const std::string& path, Entry& entry) {
+	entry.validUntil = now() + this->valid;
+	struct stat info;
+	if (stat(path.c_str(), &info) == -1) {
+		closeEntry(entry);
+		entry.error = errno;
+		return;
+	}
+	// The descriptor is still good if the path refers to the same, unchanged file
+	if (entry.error == 0 && info.st_dev == entry.info.st_dev && info.st_ino == entry.info.st_ino
+		&& info.st_size == entry.info.st_size && info.st_mtime == entry.info.st_mtime
+		&& info.st_mtim.tv_nsec == entry.info.st_mtim.tv_nsec)
+		return;
+	closeEntry(entry);
+	entry.error = 0;
+	entry.info = info;
+}
+
+void FileCache::openEntry(const std::string& path, Entry& entry) {
+	if (entry.error != 0 || entry.fd != -1 || !S_ISREG(entry.info.st_mode))
+		return;
+	entry.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	// Describes the file that was actually opened, the path may have been replaced meanwhile
+	if (entry.fd == -1 || fstat(entry.fd, &entry.info) == -1) {
+		entry.error = errno;
+		closeEntry(entry);
+	}
+}
+
+void FileCache::drop(std::map<std::string, Entry>::iterator it) {
+	closeEntry(it->second);
+	this->recent.erase(it->second.recent);
+	this->entries.erase(it);
+}
+
+void FileCache::closeEntry(Entry& entry) {
+	if (entry.fd != -1)
+		close(entry.fd);
+	entry.fd = -1;
+}
+
+time_t FileCache::now() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+	return time.tv_sec;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "FileSink.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+FileSink::FileSink() : fd(-1), failed(false) {}
+
+FileSink::~FileSink() {
+	abort();
+}
+
+bool FileSink::open(const std::string& path) {
+	abort();
+	std::string directory = path.substr(0, path.find_last_of('/') + 1);
+	std::string pattern = directory + ".upload-XXXXXX";
+	std::vector<char> name(pattern.begin(), pattern.end());
+	name.push_back('\0');
+	this->fd = mkstemp(&name[0]);
+	if (this->fd == -1)
+		return false;
+	fcntl(this->fd, F_SETFD, FD_CLOEXEC);
+	// mkstemp() creates the file for the owner only, uploads get the permissions of a regular file
+	fchmod(this->fd, 0644);
+	this->path = path;
+	this->tempPath = &name[0];
+	this->failed = false;
+	return true;
+}
+
+bool FileSink::isOpen() const {
+	return this->fd != -1;
+}
+
+void FileSink::write(const char* data, size_t length) {
+	while (length > 0 && !this->failed) {
+		ssize_t written = ::write(this->fd, data, length);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0) {
+			this->failed = true;
+			break;
+		}
+		data += written;
+		length -= written;
+	}
+}
+
+int FileSink::commit() {
+	int error = this->failed ? EIO : 0;
+	if (close(this->fd) == -1 && error == 0)
+		error = errno;
+	this->fd = -1;
+	if (error == 0 && link(this->tempPath.c_str(), this->path.c_str()) == -1)
+		error = errno;
+	unlink(this->tempPath.c_str());
+	return error;
+}
+
+void FileSink::abort() {
+	if (this->fd == -1)
+		return;
+	close(this->fd);
+	this->fd = -1;
+	unlink(this->tempPath.c_str());
+}
\ No newline at end of file
@@ -1,56 +1,37 @@
 #include "HTTPRequest.hpp"
 
-HTTPRequest::HTTPRequest() {}
-
-HTTPRequest::HTTPRequest(const std::string& request) {
-	parseRequest(request);
-}
-
-HTTPRequest::~HTTPRequest() {}
-
-void HTTPRequest::parseRequest(const std::string& request) {
-	std::istringstream requestStream(request);
-	std::string line;
-	std::getline(requestStream, line);
-	std::istringstream lineStream(line);
-	lineStream >> this->method;
-	lineStream >> this->uri;
-	lineStream >> this->version;
-	parseHeaders(requestStream);
-	parseBody(requestStream);
+HTTPRequest::HTTPRequest(const std::string& buffer, const RequestParser& parser) :
+	method(RequestParser::str(buffer, parser.getMethod())),
+	uri(RequestParser::str(buffer, parser.getURI())),
+	version(RequestParser::str(buffer, parser.getVersion())),
+	buffer(&buffer),
+	parser(&parser),
+	currentPart(NULL)
+{
+	parseBody();
 	SUCCESS("Recived HTTP Request: " << method << " on " << uri);
 }
 
-void HTTPRequest::parseHeaders(std::istringstream& stream) {
-	std::string line;
-	while (std::getline(stream, line) && line != "\r") {
-		size_t colonPos = line.find(":");
-		if (colonPos != std::string::npos) {
-			std::string key = line.substr(0, colonPos);
-			std::string value = trim(line.substr(colonPos + 1));
-			this->headers[key] = value;
-		}
-	}
-}
+HTTPRequest::~HTTPRequest() {}
 
-void HTTPRequest::parseBody(std::istringstream& stream) {
-	std::string contentType = this->headers["Content-Type"];
+void HTTPRequest::parseBody() {
+	// A streamed body was already written by its sink
+	if (this->parser->isBodyStreamed())
+		return;
+	const char* data = this->parser->getBody(*this->buffer);
+	size_t length = this->parser->getContentLength();
+	if (!this->parser->isChunked())
+		length = std::min(length, this->buffer->size() - this->parser->getBodyOffset());
+	std::string contentType = getHeader("Content-Type");
 	if (contentType.find("multipart/form-data") != std::string::npos) {
-		std::string boundary = extractBoundary(contentType);
+		std::string boundary = MultipartParser::extractBoundary(contentType);
 		if (!boundary.empty()) {
-			parseMultipartFile(stream, boundary);
+			parseMultipart(data, data + length, boundary);
 		} else {
 			ERROR("Could not find boundry for multipart/form-data");
 		}
 	} else {
-		std::string contentLength = this->headers["Content-Length"];
-		if (!contentLength.empty()) {
-			std::istringstream iss(contentLength);
-			int length;
-			iss >> length;
-			this->body.resize(length);
-			stream.read(&body[0], length);
-		}
+		this->body.assign(data, length);
 	}
 }
 
@@ -58,68 +39,34 @@ void HTTPRequest::parseBody(std::istringstream& stream) {
 /*                                File parsing                                */
 /* -------------------------------------------------------------------------- */
 
-void HTTPRequest::parseMultipartFile(std::istream& stream, const std::string& boundary) {
-	std::string boundaryString = "\r\n" + boundary;
-	std::vector<char> boundaryBytes(boundaryString.begin(), boundaryString.end());
-	std::vector<char> buffer;
-	bool readingHeaders = true;
-	std::vector<char> fileContent;
-
-	char ch;
-	while (stream.get(ch)) {
-		buffer.push_back(ch);
-		if (readingHeaders) {
-			if (buffer.size() > 4 && std::equal(buffer.end() - 4, buffer.end(), "\r\n\r\n")) {
-				parseMultipartHeaders(buffer);
-				readingHeaders = false;
-				buffer.clear();
-				continue;
-			}
-		} else {
-			 if (std::equal(boundaryBytes.begin(), boundaryBytes.end(), buffer.end() - boundaryBytes.size())) {
-				// Stop capturing file content just before the boundary
-				fileContent.insert(fileContent.end(), buffer.begin(), buffer.end() - boundaryBytes.size());
-				break;
-			}
-		}
+void HTTPRequest::parseMultipart(const char* begin, const char* end, const std::string& boundary) {
+	MultipartParser multipart(boundary, *this);
+	multipart.feed(begin, end - begin);
+	if (!multipart.done()) {
+		ERROR("Incomplete or malformed multipart/form-data body");
+		this->files.clear();
+		this->formFields.clear();
 	}
-	this->body.assign(fileContent.begin(), fileContent.end());
 }
 
-void HTTPRequest::parseMultipartHeaders(const std::vector<char>& buffer) {
-	std::string headers(buffer.begin(), buffer.end() - 4); // Exclude the last \r\n\r\n
-	std::istringstream headerStream(headers);
-	std::string line;
-	while (std::getline(headerStream, line)) {
-		if (line.find("Content-Disposition:") != std::string::npos) {
-			size_t namePos = line.find("filename=\"");
-			if (namePos != std::string::npos) {
-				namePos += 10;
-				size_t endPos = line.find("\"", namePos);
-				this->fileName = line.substr(namePos, endPos - namePos);
-			}
-		} else if (line.find("Content-Type:") != std::string::npos) {
-			size_t startPos = line.find(":") + 2;
-			this->fileContentType = line.substr(startPos);
-		}
+void HTTPRequest::beginPart(const MultipartPart& part) {
+	if (part.fileName.empty()) {
+		this->currentPart = &this->formFields[part.name];
+		this->currentPart->clear();
+		return;
 	}
+	this->files.push_back(UploadedFile());
+	this->files.back().fileName = part.fileName;
+	this->files.back().contentType = part.contentType;
+	this->currentPart = &this->files.back().content;
 }
 
-std::string HTTPRequest::extractBoundary(const std::string& contentType) const {
-	size_t boundaryPos = contentType.find("boundary=");
-	if (boundaryPos == std::string::npos) {
-		return "";
-	}
-
-	std::string boundary = contentType.substr(boundaryPos + 9);
-	size_t semicolonPos = boundary.find(";");
-	if (semicolonPos != std::string::npos) {
-		boundary = boundary.substr(0, semicolonPos);
-	}
+void HTTPRequest::partData(const char* data, size_t length) {
+	this->currentPart->append(data, length);
+}
 
-	// Ensure boundary is properly prefixed
-	boundary = "--" + boundary;
-	return boundary;
+void HTTPRequest::endPart() {
+	this->currentPart = NULL;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -127,10 +74,7 @@ std::string HTTPRequest::extractBoundary(const std::string& contentType) const {
 /* -------------------------------------------------------------------------- */
 
 std::string HTTPRequest::getHeader(const std::string& name) const {
-	std::map<std::string, std::string>::const_iterator iter = this->headers.find(name);
-	if (iter != this->headers.end())
-		return iter->second;
-	return "";
+	return this->parser->getHeader(*this->buffer, name.c_str());
 }
 
 std::string HTTPRequest::getMethod() const {
@@ -145,14 +89,17 @@ std::string HTTPRequest::getVersion() const {
 	return this->version;
 }
 
-std::string HTTPRequest::getBody() const {
+const std::string& HTTPRequest::getBody() const {
 	return this->body;
 }
 
-std::string HTTPRequest::getFileName() const {
-	return this->fileName;
+const std::vector<UploadedFile>& HTTPRequest::getFiles() const {
+	return this->files;
 }
 
-std::string HTTPRequest::getFileContentType() const {
-	return this->fileContentType;
+std::string HTTPRequest::getFormField(const std::string& name) const {
+	std::map<std::string, std::string>::const_iterator field = this->formFields.find(name);
+	if (field == this->formFields.end())
+		return "";
+	return field->second;
 }
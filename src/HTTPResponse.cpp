@@ -1,26 +1,58 @@
 #include "HTTPResponse.hpp"
 
 const std::map<int, std::string> HTTPResponse::statusCodes = HTTPResponse::initializeStatusCodes();
-
-HTTPResponse::HTTPResponse() {}
-
-HTTPResponse::~HTTPResponse() {}
+const std::vector<std::string> HTTPResponse::statusLines = HTTPResponse::initializeStatusLines();
+
+HTTPResponse::HTTPResponse(FileCache* fileCache, ContentCache* contentCache, DirectoryCache* directoryCache) :
+	cached(NULL),
+	sharedBody(NULL),
+	fileCache(fileCache),
+	contentCache(contentCache),
+	errorPages(NULL),
+	directoryCache(directoryCache),
+	compression(NULL),
+	encoding(ENCODING_IDENTITY),
+	headOnly(false),
+	streamed(false)
+{}
+
+HTTPResponse::~HTTPResponse() {
+	dropBody();
+}
 
 std::map<int, std::string> HTTPResponse::initializeStatusCodes() {
 	std::map<int, std::string> statusCodes;
 	statusCodes[200] = "OK";
 	statusCodes[201] = "Created";
+	statusCodes[206] = "Partial Content";
 	statusCodes[302] = "Found";
+	statusCodes[304] = "Not Modified";
+	statusCodes[400] = "Bad Request";
 	statusCodes[403] = "Forbidden";
 	statusCodes[404] = "Not Found";
 	statusCodes[405] = "Method Not Allowed";
 	statusCodes[408] = "Request Timeout";
 	statusCodes[413] = "Payload Too Large";
+	statusCodes[416] = "Range Not Satisfiable";
+	statusCodes[431] = "Request Header Fields Too Large";
 	statusCodes[500] = "Internal Server Error";
 	statusCodes[501] = "Not Implemented";
 	return statusCodes;
 }
 
+std::vector<std::string> HTTPResponse::initializeStatusLines() {
+	std::vector<std::string> statusLines;
+	for (int code = 100; code < 600; code++) {
+		std::map<int, std::string>::const_iterator reason = statusCodes.find(code);
+		statusLines.push_back("HTTP/1.1 " + ::toString(code) + " " + (reason != statusCodes.end() ? reason->second : "") + "\r\n");
+	}
+	return statusLines;
+}
+
+const std::map<int, std::string>& HTTPResponse::getStatusCodes() {
+	return statusCodes;
+}
+
 void HTTPResponse::prepareResponse(HTTPRequest& request, ClientState& client) {
 	std::string method = request.getMethod();
 	if (!isMethodAllowed(method, request.getURI(), client.serverConfig)) {
@@ -41,10 +73,11 @@ void HTTPResponse::prepareResponse(HTTPRequest& request, ClientState& client) {
 	}
 	switch (stringToRequestType(method)) {
 		case GET:
+		case HEAD:
 			handleRequestGET(request, client);
 			break;
 		case POST:
-			handleRequestPOST(request, client.serverConfig);
+			handleRequestPOST(request, client);
 			break;
 		case DELETE:
 			handleRequestDELETE(request, client.serverConfig);
@@ -63,6 +96,10 @@ void HTTPResponse::prepareResponse(HTTPRequest& request, ClientState& client) {
 void HTTPResponse::handleRequestGET(const HTTPRequest& request, ClientState& client) {
 	std::string requestURI = request.getURI();
 	static int image = 0;
+	this->ifNoneMatch = request.getHeader("If-None-Match");
+	this->ifModifiedSince = request.getHeader("If-Modified-Since");
+	this->range = request.getHeader("Range");
+	this->ifRange = request.getHeader("If-Range");
 	
 	if (requestURI == "/get-images") {
 		image++;
@@ -72,18 +109,23 @@ void HTTPResponse::handleRequestGET(const HTTPRequest& request, ClientState& cli
 		images.push_back("/images/image2.jpg");
 		images.push_back("/images/image3.jpg");
 		std::string imagePath = client.serverConfig.rootDirectory + images[image % images.size()];
-		std::ifstream file(imagePath.c_str());
 		INFO("Serving image: " << imagePath);
-		if (file) {
-			std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-			assignResponse(200, content, determineContentType(imagePath));
-			file.close();
-		} else {
+		if (!assignFile(200, imagePath, determineContentType(imagePath))) {
 			WARNING("Image: '" << imagePath << "' not found. Serving 404 page");
 			assignGenericResponse(404, "These Are Not the Images You Are Looking For");
 		}
 	} else {
-		serveFile(client, requestURI);
+		// The query only selects the page of a directory listing
+		size_t queryPos = requestURI.find('?');
+		if (queryPos != std::string::npos) {
+			this->query = requestURI.substr(queryPos + 1);
+			requestURI.erase(queryPos);
+		}
+		std::string fullPath = client.serverConfig.rootDirectory + requestURI;
+		if (!serveCached(fullPath)) {
+			serveFile(client, requestURI);
+			storeInCache(fullPath);
+		}
 	}
 }
 
@@ -91,32 +133,36 @@ void HTTPResponse::handleRequestGET(const HTTPRequest& request, ClientState& cli
 /*                                 POST Method                                */
 /* -------------------------------------------------------------------------- */
 
-void HTTPResponse::handleRequestPOST(const HTTPRequest& request, const ServerConfig& serverConfig) {
-	std::string requestURI = request.getURI();
-	std::string savePath = serverConfig.rootDirectory + requestURI + request.getFileName();
-
-	bool fileExists = (access(savePath.c_str(), F_OK) != -1);
-	if (fileExists) {
-		WARNING("File already exists: " + savePath);
-		setHeader("Location", requestURI + request.getFileName());
-		setStatusCode(302);
-		setBody("");
+void HTTPResponse::handleRequestPOST(const HTTPRequest& request, ClientState& client) {
+	Upload* upload = client.upload;
+	if (!upload) {
+		ERROR("No upload was started for POST on " + request.getURI());
+		assignGenericResponse(500);
 		return;
 	}
-	std::ofstream outFile(savePath.c_str());
-	if (outFile) {
-		outFile.write(request.getBody().c_str(), request.getBody().size());
-		outFile.close();
-		if (!outFile.fail()) {
-			INFO("File uploaded successfully: " + savePath);
-			assignGenericResponse(201, savePath);
-		} else {
-			ERROR("Failed to store file");
-			assignGenericResponse(500);
+	upload->finish();
+	switch (upload->getStatus()) {
+		case 201: {
+			const std::vector<std::string>& savedPaths = upload->getSavedPaths();
+			std::string payload;
+			for (size_t i = 0; i < savedPaths.size(); i++) {
+				payload += (i ? ", " : "") + savedPaths[i];
+				if (this->fileCache)
+					this->fileCache->invalidate(savedPaths[i]);
+				if (this->contentCache)
+					this->contentCache->invalidate(savedPaths[i]);
+			}
+			assignGenericResponse(201, payload);
+			break;
 		}
-	} else {
-		ERROR("Unable to open file for writing: " + savePath);
-		assignGenericResponse(500);
+		case 302:
+			setHeader("Location", upload->getLocation());
+			setStatusCode(302);
+			setBody("");
+			break;
+		default:
+			assignGenericResponse(upload->getStatus());
+			break;
 	}
 }
 
@@ -128,6 +174,10 @@ void HTTPResponse::handleRequestDELETE(const HTTPRequest& request, const ServerC
 	std::string requestURI = request.getURI();
 	INFO("DELETE method called for server: " << serverConfig.serverName);
 	requestURI = serverConfig.rootDirectory + requestURI; 
+	if (this->fileCache)
+		this->fileCache->invalidate(requestURI);
+	if (this->contentCache)
+		this->contentCache->invalidate(requestURI);
 	if (access(requestURI.c_str(), F_OK) != 0) {
 		ERROR("File does not exist: " + requestURI);
 		assignGenericResponse(404);
@@ -165,26 +215,18 @@ std::string HTTPResponse::extractFolderName(const std::string& uri) {
 
 bool HTTPResponse::serveIndex(const ServerConfig& serverConfig){
 		std::string indexPath = serverConfig.rootDirectory + (serverConfig.rootDirectory[serverConfig.rootDirectory.size() - 1] == '/' ? "" : "/") + serverConfig.indexFile;
-		std::ifstream indexFile(indexPath.c_str());
-		if (!indexFile.fail()) {
+		if (assignFile(200, indexPath, determineContentType(indexPath))) {
 			INFO("Serving index: " << indexPath);
-			std::string content((std::istreambuf_iterator<char>(indexFile)), std::istreambuf_iterator<char>());
-			assignResponse(200, content, "text/html");
-			indexFile.close();
 			return (true);
-		} else if (indexFile.fail())
+		} else
 			WARNING("Failed to open index.html!");
 		return (false);
 }
 
 bool HTTPResponse::serveDefaultFile(const std::string& uri, const std::string& fullPath) {
 		std::string folderNameHtml = fullPath + (fullPath[fullPath.size() - 1] == '/' ? "" : "/") + extractFolderName(uri) + ".html";
-		std::ifstream folderHtmlFile(folderNameHtml.c_str());
-		if (!folderHtmlFile.fail()) {
+		if (assignFile(200, folderNameHtml, determineContentType(folderNameHtml))) {
 			INFO("Serving Default File for Folder: " << folderNameHtml);
-			std::string content((std::istreambuf_iterator<char>(folderHtmlFile)), std::istreambuf_iterator<char>());
-			assignResponse(200, content, "text/html");
-			folderHtmlFile.close();
 			return (true);
 		} else
 			WARNING("Failed to open " << folderNameHtml);
@@ -192,101 +234,125 @@ bool HTTPResponse::serveDefaultFile(const std::string& uri, const std::string& f
 }
 
 void HTTPResponse::serveDirectoryListing(const std::string& uri, const std::string& fullPath) {
-	DIR* dir = opendir(fullPath.c_str());
-	if (dir != NULL) {
-		INFO("Serving Directory Listing of: " << fullPath);
-		struct dirent* entry;
-		std::string content = "";
-		while ((entry = readdir(dir)) != NULL) {
-			if (entry->d_name[0] == '.')
-				continue;
-			std::string name = entry->d_name;
-			std::string link = uri + (uri[uri.size() - 1] == '/' ? "" : "/") + name;
-			content += "<li><a href='" + link + "'>" + name + "</a></li>";
-		}
-		closedir(dir);
-		std::ostringstream stream;
-		stream << "<!DOCTYPE html>"
-			<< "<html lang=\"en\">"
-			<< "<head>"
-			<< "<meta charset=\"UTF-8\">"
-			<< "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-			<< "<title>Directory Listing of " << uri << "</title>"
-			<< "<link rel=\"stylesheet\" href=\"\\styles.css\">"
-			<< "<link rel=\"icon\" type=\"image/x-icon\" href=\"favicon.ico\">"
-			<< "</head>"
-			<< "<body class=\"background\">"
-			<< "<div class=\"error\">Directory Listing of " << uri << "</div>"
-			<< "<hr>"
-			<< "<div class=\"info\">" << content << "</div>"
-			<< "<button onclick=\"window.history.back()\" class=\"back-button\">Back</button>"
-			<< "</body>"
-			<< "</html>";
-		assignResponse(200, stream.str(), "text/html");
-	} else {
-		WARNING("Failed to open directory: '" << fullPath << "'. Serving 404 page");
-		assignGenericResponse(404, "This should never happen! HOW?!");
-	}
+	serveListing(uri, fullPath, false);
 }
 
 void HTTPResponse::serveDeletePage(const std::string& uri, const std::string& fullPath) {
-	DIR* dir = opendir(fullPath.c_str());
-	if (dir != NULL) {
-		INFO("Serving Delete page of: " << fullPath);
-		struct dirent* entry;
-		std::string content = "";
-		while ((entry = readdir(dir)) != NULL) {
-			if (entry->d_name[0] == '.')
-				continue;
-			std::string name = entry->d_name;
-			std::string link = uri + (uri[uri.size() - 1] == '/' ? "" : "/") + name;
-			std::string deleteButton = "<button onclick=\""
-									"fetch('" + link + "', {method: 'DELETE'})"
-									".then(function(response) { "
-									"if (response.ok) { "
-									"window.location.reload();"
-									"} else { "
-									"alert('Delete failed with status: ' + response.status);"
-									"}"
-									"})"
-									".catch(function(error) {"
-									"alert('Network error or no response from server');"
-									"})\">"
-									"Delete</button>";
-			content += "<li><a href='" + link + "'>" + name + "</a>" + deleteButton + "</li>";
-		}
-		closedir(dir);
-		std::ostringstream stream;
-		stream << "<!DOCTYPE html>"
-			<< "<html lang=\"en\">"
-			<< "<head>"
-			<< "<meta charset=\"UTF-8\">"
-			<< "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-			<< "<title>Delete page of " << uri << "</title>"
-			<< "<link rel=\"stylesheet\" href=\"\\styles.css\">"
-			<< "<link rel=\"icon\" type=\"image/x-icon\" href=\"favicon.ico\">"
-			<< "</head>"
-			<< "<body class=\"background\">"
-			<< "<div class=\"error\">Delete page of " << uri << "</div>"
-			<< "<hr>"
-			<< "<div class=\"info\">" << content << "</div>"
-			<< "<button onclick=\"window.history.back()\" class=\"back-button\">Back</button>"
-			<< "</body>"
-			<< "</html>";
-		assignResponse(200, stream.str(), "text/html");
-	} else {
+	serveListing(uri, fullPath, true);
+}
+
+void HTTPResponse::serveListing(const std::string& uri, const std::string& fullPath, bool deletePage) {
+	DirectoryCache::Listing local;
+	DirectoryCache::Listing* listing = NULL;
+	if (this->directoryCache)
+		listing = this->directoryCache->lookup(fullPath);
+	else if (DirectoryCache::load(fullPath, local))
+		listing = &local;
+	if (!listing) {
 		WARNING("Failed to open directory: '" << fullPath << "'. Serving 404 page");
-		assignGenericResponse(404, "This should never happen. Yet it did. How?");
+		assignGenericResponse(404, deletePage ? "This should never happen. Yet it did. How?" : "This should never happen! HOW?!");
+		return;
 	}
+	INFO("Serving " << (deletePage ? "Delete page" : "Directory Listing") << " of: " << fullPath);
+	std::string sortName = getQueryParameter(this->query, "sort");
+	DirectorySort sort = SORT_NAME;
+	if (sortName == "size")
+		sort = SORT_SIZE;
+	else if (sortName == "date")
+		sort = SORT_DATE;
+	else
+		sortName = "name";
+	bool descending = getQueryParameter(this->query, "order") == "desc";
+	size_t limit = std::strtoul(getQueryParameter(this->query, "limit").c_str(), NULL, 10);
+	if (limit == 0)
+		limit = LISTING_PAGE_SIZE;
+	limit = std::min(limit, static_cast<size_t>(LISTING_PAGE_SIZE_MAX));
+	size_t count = listing->entries.size();
+	size_t pages = std::max(static_cast<size_t>(1), (count + limit - 1) / limit);
+	size_t page = std::strtoul(getQueryParameter(this->query, "page").c_str(), NULL, 10);
+	page = std::min(std::max(page, static_cast<size_t>(1)), pages);
+
+	// Rendered once per directory state, the cached listing is dropped as soon as the directory changes
+	std::string key = (deletePage ? "delete " : "list ") + listingLink(uri, sortName, descending, page, limit);
+	std::map<std::string, std::string>::iterator cached = listing->pages.find(key);
+	if (cached != listing->pages.end()) {
+		assignResponse(200, cached->second, "text/html");
+		return;
+	}
+	std::string title = (deletePage ? "Delete page of " : "Directory Listing of ") + uri;
+	std::string base = uri + (uri[uri.size() - 1] == '/' ? "" : "/");
+	size_t first = (page - 1) * limit;
+	size_t last = std::min(count, first + limit);
+	std::string content;
+	content.reserve(1024 + (last - first) * (2 * base.size() + 64 + (deletePage ? 320 : 0)));
+	content += "<!DOCTYPE html>"
+		"<html lang=\"en\">"
+		"<head>"
+		"<meta charset=\"UTF-8\">"
+		"<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
+		"<title>" + title + "</title>"
+		"<link rel=\"stylesheet\" href=\"\\styles.css\">"
+		"<link rel=\"icon\" type=\"image/x-icon\" href=\"favicon.ico\">"
+		"</head>"
+		"<body class=\"background\">"
+		"<div class=\"error\">" + title + "</div>"
+		"<hr>"
+		"<div class=\"info\">";
+	// A link to the current order reverses it
+	const char* sortNames[] = {"name", "size", "date"};
+	content += "<p>Sort by";
+	for (size_t i = 0; i < 3; i++) {
+		bool reverse = sortName == sortNames[i] && !descending;
+		content += std::string(i == 0 ? " " : " | ") + "<a href='" + listingLink(uri, sortNames[i], reverse, 1, limit) + "'>" + sortNames[i] + "</a>";
+	}
+	content += "</p>";
+	const std::vector<size_t>& order = DirectoryCache::sorted(*listing, sort);
+	for (size_t i = first; i < last; i++) {
+		const std::string& name = listing->entries[order[descending ? count - 1 - i : i]].name;
+		std::string link = base + name;
+		content.append("<li><a href='").append(link).append("'>").append(name).append("</a>");
+		if (deletePage) {
+			content.append("<button onclick=\""
+				"fetch('").append(link).append("', {method: 'DELETE'})"
+				".then(function(response) { "
+				"if (response.ok) { "
+				"window.location.reload();"
+				"} else { "
+				"alert('Delete failed with status: ' + response.status);"
+				"}"
+				"})"
+				".catch(function(error) {"
+				"alert('Network error or no response from server');"
+				"})\">"
+				"Delete</button>");
+		}
+		content += "</li>";
+	}
+	if (pages > 1) {
+		content += "<p>";
+		if (page > 1)
+			content += "<a href='" + listingLink(uri, sortName, descending, page - 1, limit) + "'>Previous</a> ";
+		content += "Page " + ::toString(page) + " of " + ::toString(pages);
+		if (page < pages)
+			content += " <a href='" + listingLink(uri, sortName, descending, page + 1, limit) + "'>Next</a>";
+		content += "</p>";
+	}
+	content += "</div>"
+		"<button onclick=\"window.history.back()\" class=\"back-button\">Back</button>"
+		"</body>"
+		"</html>";
+	if (listing->pages.size() >= DIRECTORY_CACHE_PAGES)
+		listing->pages.clear();
+	assignResponse(200, listing->pages[key] = content, "text/html");
+}
+
+std::string HTTPResponse::listingLink(const std::string& uri, const std::string& sort, bool descending, size_t page, size_t limit) {
+	return uri + "?sort=" + sort + "&order=" + (descending ? "desc" : "asc") + "&page=" + ::toString(page) + "&limit=" + ::toString(limit);
 }
 
 void HTTPResponse::serveRegularFile(const std::string& uri, const std::string& fullPath) {
-	std::ifstream file(fullPath.c_str());
-	if (!file.fail()) {
-		INFO("Serving file: " << fullPath);
-		std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-		assignResponse(200, content, determineContentType(uri));
-		file.close();
+	if (assignFile(200, fullPath, determineContentType(fullPath))) {
+		INFO("Serving file: " << uri << " from " << fullPath);
 	} else {
 		WARNING("File '" << fullPath << "' not found. Serving 404 page");
 		assignGenericResponse(404, "These Are Not the Files You Are Looking For");
@@ -307,7 +373,8 @@ bool HTTPResponse::cheekySlashes(const std::string& uri) {
 void HTTPResponse::serveFile(ClientState& client, const std::string& uri) {
 	std::string fullPath = client.serverConfig.rootDirectory + uri;
 	struct stat path_stat;
-	stat(fullPath.c_str(), &path_stat);
+	if (!lookupFile(fullPath, path_stat))
+		path_stat.st_mode = 0;
 	if (S_ISDIR(path_stat.st_mode)) {
 		if (cheekySlashes(uri) && serveIndex(client.serverConfig))
 			return;
@@ -327,32 +394,59 @@ void HTTPResponse::serveFile(ClientState& client, const std::string& uri) {
 	}
 }
 
-std::string HTTPResponse::determineContentType(std::string requestURI) {
-	if (endsWith(requestURI, ".css")) {
-		return "text/css";
-	} else if (endsWith(requestURI, ".jpg") || endsWith(requestURI, ".jpeg")) {
-		return "image/jpeg";
-	} else if (endsWith(requestURI, ".png")) {
-		return "image/png";
-	} else if (endsWith(requestURI, ".pdf")) {
-		return "application/pdf";
-	} else if (endsWith(requestURI, ".ico")) {
-		return "image/x-icon";
-	}
-	return "text/html";
+const std::string& HTTPResponse::determineContentType(const std::string& path) {
+	if (this->fileCache)
+		return *this->fileCache->lookup(path).contentType;
+	static const MimeTypes builtinTypes;
+	return builtinTypes.resolve(path);
 }
 
 std::string HTTPResponse::convertToString() const {
-	std::ostringstream responseStream;
-	responseStream << "HTTP/1.1 " << this->statusCode << " " << "\r\n";
-	for (std::map<std::string, std::string>::const_iterator const_iter = this->headers.begin(); const_iter != this->headers.end(); const_iter++) {
-		responseStream << const_iter->first << ": " << const_iter->second << "\r\n";
+	std::string response;
+	if (this->cached) {
+		appendStatusLine(response);
+		return response + this->cached->str();
 	}
-	responseStream << "\r\n" << this->body;
-	return responseStream.str();
+	response = convertHeadersToString();
+	if (this->sharedBody && !this->headOnly)
+		response += this->sharedBody->str();
+	else if (this->files.empty() && !this->headOnly)
+		response += this->body;
+	return response;
 }
 
-bool HTTPResponse::isMethodAllowed(const std::string& method, const std::string& uri, const ServerConfig& serverConfig) {
+std::string HTTPResponse::convertHeadersToString() const {
+	size_t size = 64;
+	for (size_t i = 0; i < this->headers.size(); i++)
+		size += this->headers[i].first.size() + this->headers[i].second.size() + 4;
+	std::string head;
+	head.reserve(size + 64);
+	appendStatusLine(head);
+	appendHeaders(head);
+	return head;
+}
+
+void HTTPResponse::appendStatusLine(std::string& out) const {
+	if (this->statusCode >= 100 && this->statusCode < 600)
+		out += statusLines[this->statusCode - 100];
+	else
+		out += "HTTP/1.1 " + ::toString(this->statusCode) + " \r\n";
+	out.append("Date: ").append(currentHTTPDate()).append("\r\n");
+}
+
+void HTTPResponse::appendHeaders(std::string& out) const {
+	bool hasLength = false;
+	for (size_t i = 0; i < this->headers.size(); i++) {
+		out.append(this->headers[i].first).append(": ").append(this->headers[i].second).append("\r\n");
+		hasLength = hasLength || this->headers[i].first == "Content-Length";
+	}
+	// Every response needs a length so the client can find the next one on a persistent connection, 304 has no body
+	if (!hasLength && !this->streamed && this->statusCode != 304)
+		out.append("Content-Length: ").append(::toString(this->body.size())).append("\r\n");
+	out += "\r\n";
+}
+
+const LocationConfig* HTTPResponse::findLocation(const std::string& uri, const ServerConfig& serverConfig) {
 	const LocationConfig* mostSpecificMatch = NULL;
 	for (std::vector<LocationConfig>::const_iterator it = serverConfig.locations.begin(); it != serverConfig.locations.end(); ++it) {
 		if (uri.find(it->locationPath) == 0) {
@@ -361,12 +455,18 @@ bool HTTPResponse::isMethodAllowed(const std::string& method, const std::string&
 			}
 		}
 	}
+	return mostSpecificMatch;
+}
+
+bool HTTPResponse::isMethodAllowed(const std::string& method, const std::string& uri, const ServerConfig& serverConfig) {
+	const LocationConfig* mostSpecificMatch = findLocation(uri, serverConfig);
 	if (mostSpecificMatch) {
 		if (mostSpecificMatch->allowedRequestTypes.empty()) {
 			return false;
 		}
 		for (std::vector<RequestTypes>::const_iterator iter = mostSpecificMatch->allowedRequestTypes.begin(); iter != mostSpecificMatch->allowedRequestTypes.end(); ++iter) {
-			if (method == requestTypeToString(*iter)) {
+			// HEAD is allowed wherever GET is (RFC 9110, section 9.3.2)
+			if (method == requestTypeToString(*iter) || (method == "HEAD" && *iter == GET)) {
 				return true;
 			}
 		}
@@ -395,45 +495,454 @@ std::string HTTPResponse::isRedirection(const std::string& uri, const ServerConf
 /* -------------------------------------------------------------------------- */
 
 void HTTPResponse::assignResponse(int statusCode, const std::string& body, std::string contentType) {
+	dropBody();
 	setHeader("Content-Type", contentType);
 	setHeader("Content-Length", ::toString(body.size()));
 	setBody(body);
 	setStatusCode(statusCode);
 }
 
+void HTTPResponse::assignCGIResponse(const CGIHeaders& headers, const std::string& body) {
+	dropBody();
+	const std::vector<std::pair<std::string, std::string> >& fields = headers.getFields();
+	bool hasType = false;
+	// Appended as they are, a script may send a field like `Set-Cookie` more than once
+	for (size_t i = 0; i < fields.size(); i++) {
+		this->headers.push_back(fields[i]);
+		hasType = hasType || fields[i].first == "Content-Type";
+	}
+	if (!hasType)
+		setHeader("Content-Type", "text/html");
+	setBody(body);
+	setStatusCode(headers.getStatusCode());
+}
+
+void HTTPResponse::setStreamed(bool chunked) {
+	this->streamed = true;
+	if (chunked)
+		setHeader("Transfer-Encoding", "chunked");
+}
+
 void HTTPResponse::assignGenericResponse(int statusCode, const std::string& message) {
-	std::ostringstream stream;
-	std::string code = ::toString(statusCode);
-	std::string codeMessage = statusCodes.find(statusCode) != statusCodes.end() ? statusCodes.at(statusCode) : "Unknown Code In Map";
-	stream << "<!DOCTYPE html>"
-			<< "<html lang=\"en\">"
-			<< "<head>"
-			<< "<meta charset=\"UTF-8\">"
-			<< "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-			<< "<title>Webserv - " << code << "</title>"
-			<< "<link rel=\"stylesheet\" href=\"\\styles.css\">"
-			<< "<link rel=\"icon\" type=\"image/x-icon\" href=\"favicon.ico\">"
-			<< "</head>"
-			<< "<body class=\"background\">"
-			<< "<div class=\"error\">" << code << " - " << codeMessage << "</div>"
-			<< "<hr>"
-			<< "<div class=\"info\">" << message << "</div>"
-			<< "<button onclick=\"window.history.back()\" class=\"back-button\">Back</button>"
-			<< "</body>"
-			<< "</html>";
-	assignResponse(statusCode, stream.str(), "text/html");
+	std::string page;
+	if (this->errorPages) {
+		this->errorPages->render(statusCode, message, page);
+	} else {
+		static const ErrorPages builtinPages;
+		builtinPages.render(statusCode, message, page);
+	}
+	dropBody();
+	setHeader("Content-Type", "text/html");
+	setHeader("Content-Length", ::toString(page.size()));
+	this->body.swap(page);
+	setStatusCode(statusCode);
+}
+
+bool HTTPResponse::assignFile(int statusCode, const std::string& path, const std::string& contentType) {
+	struct stat fileStat;
+	if (!lookupFile(path, fileStat) || !S_ISREG(fileStat.st_mode))
+		return false;
+	// The representation depends on Accept-Encoding whenever the type can be compressed
+	bool varies = this->compression && this->compression->isCompressibleType(contentType);
+	ContentEncoding encoding = ENCODING_IDENTITY;
+	// Ranges are served from the uncompressed file
+	if (varies && statusCode == 200 && this->range.empty() && fileStat.st_size <= GZIP_MAX_FILE
+		&& this->compression->isCompressibleLength(fileStat.st_size))
+		encoding = this->encoding;
+	// A matching conditional request and HEAD are answered from the metadata, the file is not opened
+	bool notModified = isNotModified(fileStat, encoding);
+	std::vector<std::pair<off_t, size_t> > ranges;
+	// HEAD and conditional requests ignore `Range`, it only applies to a GET that would be answered with 200
+	int rangeStatus = statusCode == 200 && !notModified && !this->headOnly ? parseRanges(fileStat, ranges) : 200;
+	if (rangeStatus == 416) {
+		assignGenericResponse(416);
+		setHeader("Content-Range", "bytes */" + ::toString(fileStat.st_size));
+		return true;
+	}
+	int fd = -1;
+	SharedBuffer* compressed = NULL;
+	if (!notModified && encoding != ENCODING_IDENTITY) {
+		// Even a HEAD request needs the compressed length
+		compressed = this->compression->lookup(path, encoding, fileStat);
+		if (!compressed) {
+			fd = openFile(path, fileStat);
+			if (fd == -1)
+				return false;
+			compressed = this->compression->compressFile(path, fd, fileStat, encoding);
+			close(fd);
+			fd = -1;
+			if (!compressed)
+				return false;
+		}
+	} else if (!notModified && !this->headOnly) {
+		fd = openFile(path, fileStat);
+		if (fd == -1)
+			return false;
+	}
+	dropBody();
+	setHeader("ETag", makeETag(fileStat, encoding));
+	setHeader("Last-Modified", formatHTTPDate(fileStat.st_mtime));
+	if (varies)
+		setHeader("Vary", "Accept-Encoding");
+	if (encoding == ENCODING_IDENTITY)
+		setHeader("Accept-Ranges", "bytes");
+	setBody("");
+	if (notModified) {
+		setStatusCode(304);
+		return true;
+	}
+	this->filePath = path;
+	setHeader("Content-Type", contentType);
+	setStatusCode(statusCode);
+	if (compressed) {
+		setHeader("Content-Encoding", Compression::encodingName(encoding));
+		setHeader("Content-Length", ::toString(compressed->str().size()));
+		this->sharedBody = compressed;
+		return true;
+	}
+	if (rangeStatus == 206 && assignRanges(fd, fileStat, contentType, ranges))
+		return true;
+	setHeader("Content-Length", ::toString(fileStat.st_size));
+	if (fd != -1) {
+		FileBody file;
+		file.fd = fd;
+		file.remaining = fileStat.st_size;
+		this->files.push_back(file);
+	}
+	return true;
+}
+
+int HTTPResponse::parseRanges(const struct stat& fileStat, std::vector<std::pair<off_t, size_t> >& ranges) const {
+	if (this->range.compare(0, 6, "bytes=") != 0)
+		return 200;
+	// If-Range asks for the ranges only if the file is still the one the client has (RFC 9110, section 13.1.5)
+	if (!this->ifRange.empty() && this->ifRange != makeETag(fileStat) && this->ifRange != formatHTTPDate(fileStat.st_mtime))
+		return 200;
+	off_t size = fileStat.st_size;
+	std::istringstream list(this->range.substr(6));
+	std::string spec;
+	size_t specs = 0;
+	while (std::getline(list, spec, ',')) {
+		spec = trim(spec);
+		size_t dash = spec.find('-');
+		// A syntactically invalid header is ignored as a whole
+		if (spec.empty() || dash == std::string::npos || ++specs > RANGE_MAX_PARTS)
+			return 200;
+		std::string first = spec.substr(0, dash);
+		std::string last = spec.substr(dash + 1);
+		if (first.find_first_not_of("0123456789") != std::string::npos || last.find_first_not_of("0123456789") != std::string::npos
+			|| (first.empty() && last.empty()) || first.size() > 18 || last.size() > 18)
+			return 200;
+		off_t start, end;
+		if (first.empty()) {
+			// A suffix range: the last `last` bytes
+			off_t suffix = std::strtoll(last.c_str(), NULL, 10);
+			if (suffix == 0)
+				continue;
+			start = suffix < size ? size - suffix : 0;
+			end = size - 1;
+		} else {
+			start = std::strtoll(first.c_str(), NULL, 10);
+			end = last.empty() ? size - 1 : std::strtoll(last.c_str(), NULL, 10);
+			if (!last.empty() && end < start)
+				return 200;
+			if (end >= size)
+				end = size - 1;
+		}
+		if (start < size)
+			ranges.push_back(std::make_pair(start, static_cast<size_t>(end - start + 1)));
+	}
+	if (specs == 0)
+		return 200;
+	return ranges.empty() ? 416 : 206;
+}
+
+bool HTTPResponse::assignRanges(int fd, const struct stat& fileStat, const std::string& contentType,
+	const std::vector<std::pair<off_t, size_t> >& ranges) {
+	std::string size = ::toString(fileStat.st_size);
+	if (ranges.size() == 1) {
+		FileBody file;
+		file.fd = fd;
+		file.offset = ranges[0].first;
+		file.remaining = ranges[0].second;
+		this->files.push_back(file);
+		setHeader("Content-Type", contentType);
+		setHeader("Content-Range", "bytes " + ::toString(file.offset) + "-" + ::toString(file.offset + file.remaining - 1) + "/" + size);
+		setHeader("Content-Length", ::toString(file.remaining));
+		setStatusCode(206);
+		return true;
+	}
+	// Every part gets its own descriptor, the output queue closes each one when the part is sent
+	std::vector<int> fds(1, fd);
+	for (size_t i = 1; i < ranges.size(); i++) {
+		int duplicate = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+		if (duplicate == -1) {
+			WARNING("Could not duplicate the descriptor for a multipart range, sending the whole file");
+			for (size_t j = 1; j < fds.size(); j++)
+				close(fds[j]);
+			return false;
+		}
+		fds.push_back(duplicate);
+	}
+	std::string boundary = makeBoundary();
+	size_t length = 0;
+	for (size_t i = 0; i < ranges.size(); i++) {
+		FileBody file;
+		file.header = (i == 0 ? "--" : "\r\n--") + boundary + "\r\nContent-Type: " + contentType + "\r\nContent-Range: bytes "
+			+ ::toString(ranges[i].first) + "-" + ::toString(ranges[i].first + ranges[i].second - 1) + "/" + size + "\r\n\r\n";
+		file.fd = fds[i];
+		file.offset = ranges[i].first;
+		file.remaining = ranges[i].second;
+		length += file.header.size() + file.remaining;
+		this->files.push_back(file);
+	}
+	setBody("\r\n--" + boundary + "--\r\n");
+	length += this->body.size();
+	setHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+	setHeader("Content-Length", ::toString(length));
+	setStatusCode(206);
+	return true;
+}
+
+std::string HTTPResponse::makeBoundary() {
+	static unsigned long counter = 0;
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	std::ostringstream boundary;
+	boundary << std::hex << "webserv-" << now.tv_sec << now.tv_nsec << "-" << ++counter;
+	return boundary.str();
+}
+
+int HTTPResponse::openFile(const std::string& path, struct stat& fileStat) {
+	if (this->fileCache) {
+		const FileCache::Entry& entry = this->fileCache->lookup(path, true);
+		if (entry.error != 0 || entry.fd == -1)
+			return -1;
+		fileStat = entry.info;
+		return fcntl(entry.fd, F_DUPFD_CLOEXEC, 0);
+	}
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd != -1 && (fstat(fd, &fileStat) == -1 || !S_ISREG(fileStat.st_mode))) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+bool HTTPResponse::isNotModified(const struct stat& fileStat, ContentEncoding encoding) const {
+	// If-None-Match takes precedence over If-Modified-Since (RFC 9110, section 13.2.2)
+	if (!this->ifNoneMatch.empty()) {
+		std::string etag = makeETag(fileStat, encoding);
+		std::istringstream list(this->ifNoneMatch);
+		std::string candidate;
+		while (std::getline(list, candidate, ',')) {
+			candidate = trim(candidate);
+			// If-None-Match uses the weak comparison
+			if (candidate.compare(0, 2, "W/") == 0)
+				candidate = candidate.substr(2);
+			if (candidate == "*" || candidate == etag)
+				return true;
+		}
+		return false;
+	}
+	if (!this->ifModifiedSince.empty()) {
+		time_t since = parseHTTPDate(this->ifModifiedSince);
+		return since != -1 && fileStat.st_mtime <= since;
+	}
+	return false;
+}
+
+std::string HTTPResponse::makeETag(const struct stat& fileStat, ContentEncoding encoding) {
+	std::ostringstream etag;
+	etag << std::hex << "\"" << fileStat.st_ino << "-" << fileStat.st_size << "-" << fileStat.st_mtime
+		<< "." << fileStat.st_mtim.tv_nsec;
+	if (encoding != ENCODING_IDENTITY)
+		etag << "-" << Compression::encodingName(encoding);
+	etag << "\"";
+	return etag.str();
+}
+
+void HTTPResponse::releaseBody(std::string& body) {
+	body.clear();
+	body.swap(this->body);
+}
+
+bool HTTPResponse::lookupFile(const std::string& path, struct stat& info) {
+	if (!this->fileCache)
+		return stat(path.c_str(), &info) == 0;
+	const FileCache::Entry& entry = this->fileCache->lookup(path);
+	if (entry.error != 0)
+		return false;
+	info = entry.info;
+	return true;
+}
+
+void HTTPResponse::releaseFiles(std::vector<FileBody>& files) {
+	files.clear();
+	files.swap(this->files);
+}
+
+void HTTPResponse::dropBody() {
+	for (size_t i = 0; i < this->files.size(); i++)
+		close(this->files[i].fd);
+	this->files.clear();
+	if (this->cached)
+		this->cached->release();
+	this->cached = NULL;
+	if (this->sharedBody)
+		this->sharedBody->release();
+	this->sharedBody = NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Content Cache                               */
+/* -------------------------------------------------------------------------- */
+
+bool HTTPResponse::serveCached(const std::string& path) {
+	// Conditional, range and HEAD requests are answered from the file cache's metadata instead
+	if (!this->contentCache || this->headOnly || !this->ifNoneMatch.empty() || !this->ifModifiedSince.empty() || !this->range.empty())
+		return false;
+	SharedBuffer* response = this->contentCache->lookup(path, this->encoding);
+	if (!response)
+		return false;
+	INFO("Serving cached file: " << path);
+	dropBody();
+	this->cached = response->retain();
+	setStatusCode(200);
+	return true;
+}
+
+void HTTPResponse::storeInCache(const std::string& path) {
+	if (!this->contentCache || this->statusCode != 200)
+		return;
+	if (this->sharedBody) {
+		storeCompressedInCache(path);
+		return;
+	}
+	if (this->files.size() != 1 || this->files[0].remaining > STATIC_CACHE_MAX_ENTRY)
+		return;
+	const FileBody& file = this->files[0];
+	// Watched before reading, a change while the file is read drops the entry again
+	if (!this->contentCache->watch(this->filePath))
+		return;
+	struct stat fileStat;
+	// The length from the file cache can be older than the watch
+	if (fstat(file.fd, &fileStat) == -1 || static_cast<size_t>(fileStat.st_size) != file.remaining)
+		return;
+	// Without the status line and the `Date` header, they are added whenever the response is sent
+	std::string response;
+	appendHeaders(response);
+	size_t headerSize = response.size();
+	response.resize(headerSize + file.remaining);
+	for (size_t done = 0; done < file.remaining;) {
+		ssize_t bytesRead = pread(file.fd, &response[headerSize + done], file.remaining - done, done);
+		if (bytesRead <= 0)
+			return;
+		done += bytesRead;
+	}
+	SharedBuffer* stored = this->contentCache->insert(path, this->encoding, this->filePath, response);
+	if (!stored)
+		return;
+	dropBody();
+	this->cached = stored->retain();
+}
+
+void HTTPResponse::storeCompressedInCache(const std::string& path) {
+	const std::string& body = this->sharedBody->str();
+	const std::string* etag = findHeader("ETag");
+	if (body.size() > STATIC_CACHE_MAX_ENTRY || !etag || !this->contentCache->watch(this->filePath))
+		return;
+	// The variant was made from the file the ETag describes, which must still be there once it is watched
+	struct stat fileStat;
+	if (stat(this->filePath.c_str(), &fileStat) == -1 || makeETag(fileStat, this->encoding) != *etag)
+		return;
+	std::string response;
+	appendHeaders(response);
+	response += body;
+	SharedBuffer* stored = this->contentCache->insert(path, this->encoding, this->filePath, response);
+	if (!stored)
+		return;
+	dropBody();
+	this->cached = stored->retain();
+}
+
+SharedBuffer* HTTPResponse::getCached() const {
+	return this->cached;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Compression                                */
+/* -------------------------------------------------------------------------- */
+
+SharedBuffer* HTTPResponse::getSharedBody() const {
+	return this->sharedBody;
+}
+
+void HTTPResponse::compressBody() {
+	if (!this->compression || this->cached || this->sharedBody || !this->files.empty() || findHeader("Content-Encoding"))
+		return;
+	const std::string* contentType = findHeader("Content-Type");
+	if (!contentType || !this->compression->isCompressibleType(*contentType))
+		return;
+	setHeader("Vary", "Accept-Encoding");
+	if (this->encoding == ENCODING_IDENTITY || this->statusCode == 304 || !this->compression->isCompressibleLength(this->body.size()))
+		return;
+	std::string compressed;
+	if (!this->compression->compress(this->body, this->encoding, compressed))
+		return;
+	this->body.swap(compressed);
+	setHeader("Content-Encoding", Compression::encodingName(this->encoding));
+	setHeader("Content-Length", ::toString(this->body.size()));
+}
+
+bool HTTPResponse::isGzipEnabled(const std::string& uri, const ServerConfig& serverConfig) {
+	const LocationConfig* location = findLocation(uri, serverConfig);
+	if (location && location->gzip != -1)
+		return location->gzip == 1;
+	return serverConfig.gzip;
 }
 
 /* -------------------------------------------------------------------------- */
 /*                              Setter Functions                              */
 /* -------------------------------------------------------------------------- */
 
+void HTTPResponse::setCompression(Compression* compression, ContentEncoding encoding) {
+	this->compression = compression;
+	this->encoding = compression ? encoding : ENCODING_IDENTITY;
+}
+
+void HTTPResponse::setErrorPages(const ErrorPages* errorPages) {
+	this->errorPages = errorPages;
+}
+
+void HTTPResponse::setHeadOnly(bool headOnly) {
+	this->headOnly = headOnly;
+}
+
+bool HTTPResponse::isHeadOnly() const {
+	return this->headOnly;
+}
+
 void HTTPResponse::setStatusCode(int code) {
 	this->statusCode = code;
 }
 
+const std::string* HTTPResponse::findHeader(const std::string& key) const {
+	for (size_t i = 0; i < this->headers.size(); i++) {
+		if (this->headers[i].first == key)
+			return &this->headers[i].second;
+	}
+	return NULL;
+}
+
 void HTTPResponse::setHeader(const std::string& key, const std::string& value) {
-	this->headers[key] = value;
+	for (size_t i = 0; i < this->headers.size(); i++) {
+		if (this->headers[i].first == key) {
+			this->headers[i].second = value;
+			return;
+		}
+	}
+	this->headers.push_back(std::make_pair(key, value));
 }
 
 void HTTPResponse::setBody(const std::string& body) {
@@ -0,0 +1,184 @@
+#include "IoUring.hpp"
+
+#ifdef WEBSERV_HAS_IO_URING
+
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+IoUring::IoUring():
+	ringFd(-1),
+	sqRing(MAP_FAILED),
+	sqRingSize(0),
+	cqRing(MAP_FAILED),
+	cqRingSize(0),
+	sqes(NULL),
+	sqesSize(0),
+	localTail(0),
+	pending(0),
+	bufRing(NULL),
+	bufRingSize(0),
+	buffers(NULL),
+	bufCount(0),
+	bufSize(0),
+	bufGroup(0),
+	bufTail(0)
+{}
+
+IoUring::~IoUring() {
+	if (this->bufRing)
+		munmap(this->bufRing, this->bufRingSize);
+	delete[] this->buffers;
+	if (this->sqes)
+		munmap(this->sqes, this->sqesSize);
+	if (this->cqRing != MAP_FAILED && this->cqRing != this->sqRing)
+		munmap(this->cqRing, this->cqRingSize);
+	if (this->sqRing != MAP_FAILED)
+		munmap(this->sqRing, this->sqRingSize);
+	if (this->ringFd >= 0)
+		close(this->ringFd);
+}
+
+bool IoUring::setup(unsigned entries) {
+	struct io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+	this->ringFd = syscall(__NR_io_uring_setup, entries, &params);
+	if (this->ringFd < 0)
+		return false;
+	if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+		return false;
+
+	this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (this->cqRingSize > this->sqRingSize)
+			this->sqRingSize = this->cqRingSize;
+		this->cqRingSize = this->sqRingSize;
+	}
+	this->sqRing = mmap(NULL, this->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFd, IORING_OFF_SQ_RING);
+	if (this->sqRing == MAP_FAILED)
+		return false;
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		this->cqRing = this->sqRing;
+	} else {
+		this->cqRing = mmap(NULL, this->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFd, IORING_OFF_CQ_RING);
+		if (this->cqRing == MAP_FAILED)
+			return false;
+	}
+	this->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqesMemory = mmap(NULL, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFd, IORING_OFF_SQES);
+	if (sqesMemory == MAP_FAILED)
+		return false;
+	this->sqes = static_cast<struct io_uring_sqe*>(sqesMemory);
+
+	char* sq = static_cast<char*>(this->sqRing);
+	char* cq = static_cast<char*>(this->cqRing);
+	this->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+	this->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	this->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	this->sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+	this->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	this->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	this->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	this->cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+	// Submission slots map 1:1 to entries of the sqes array
+	unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+	for (unsigned i = 0; i < this->sqEntries; i++)
+		array[i] = i;
+	this->localTail = *this->sqTail;
+	return true;
+}
+
+bool IoUring::setupBuffers(unsigned short group, unsigned count, unsigned size) {
+	this->bufRingSize = count * sizeof(struct io_uring_buf);
+	void* ring = mmap(NULL, this->bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED)
+		return false;
+	this->bufRing = static_cast<struct io_uring_buf_ring*>(ring);
+	struct io_uring_buf_reg reg;
+	std::memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = reinterpret_cast<uintptr_t>(ring);
+	reg.ring_entries = count;
+	reg.bgid = group;
+	if (syscall(__NR_io_uring_register, this->ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+		return false;
+	this->bufGroup = group;
+	this->bufCount = count;
+	this->bufSize = size;
+	this->buffers = new char[static_cast<size_t>(count) * size];
+	for (unsigned i = 0; i < count; i++)
+		recycleBuffer(i);
+	return true;
+}
+
+struct io_uring_sqe* IoUring::getSqe() {
+	if (this->localTail - __atomic_load_n(this->sqHead, __ATOMIC_ACQUIRE) >= this->sqEntries)
+		enter(0, 0);
+	struct io_uring_sqe* sqe = &this->sqes[this->localTail & this->sqMask];
+	std::memset(sqe, 0, sizeof(*sqe));
+	this->localTail++;
+	this->pending++;
+	return sqe;
+}
+
+int IoUring::enter(unsigned waitNr, int timeout) {
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	std::memset(&arg, 0, sizeof(arg));
+	arg.sigmask_sz = _NSIG / 8;
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000L;
+		arg.ts = reinterpret_cast<uintptr_t>(&ts);
+	}
+	__atomic_store_n(this->sqTail, this->localTail, __ATOMIC_RELEASE);
+	unsigned flags = IORING_ENTER_EXT_ARG;
+	if (waitNr > 0)
+		flags |= IORING_ENTER_GETEVENTS;
+	int result = syscall(__NR_io_uring_enter, this->ringFd, this->pending, waitNr, flags, &arg, sizeof(arg));
+	if (result >= 0)
+		this->pending -= static_cast<unsigned>(result) < this->pending ? result : this->pending;
+	return result;
+}
+
+int IoUring::submitAndWait(int timeout) {
+	bool ready = __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE) != *this->cqHead;
+	int result = enter(ready ? 0 : 1, timeout);
+	if (result < 0 && errno == ETIME)
+		return 0;
+	return result;
+}
+
+struct io_uring_cqe* IoUring::peek() {
+	unsigned head = *this->cqHead;
+	if (head == __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE))
+		return NULL;
+	return &this->cqes[head & this->cqMask];
+}
+
+void IoUring::advance() {
+	__atomic_store_n(this->cqHead, *this->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+char* IoUring::getBuffer(unsigned short bid) {
+	return this->buffers + static_cast<size_t>(bid) * this->bufSize;
+}
+
+void IoUring::recycleBuffer(unsigned short bid) {
+	// Not `bufRing->bufs`: in C++ the empty struct of __DECLARE_FLEX_ARRAY shifts that member
+	struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(this->bufRing) + (this->bufTail & (this->bufCount - 1));
+	buf->addr = reinterpret_cast<uintptr_t>(getBuffer(bid));
+	buf->len = this->bufSize;
+	buf->bid = bid;
+	this->bufTail++;
+	__atomic_store_n(&this->bufRing->tail, this->bufTail, __ATOMIC_RELEASE);
+}
+
+unsigned short IoUring::getBufferGroup() const {
+	return this->bufGroup;
+}
+
+#endif
\ No newline at end of file
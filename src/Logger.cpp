@@ -11,6 +11,7 @@ bool Logger::errorEnabled;
 bool Logger::useFileLine;
 bool Logger::useTimestamp;
 bool Logger::useLevel;
+pthread_mutex_t Logger::mutex = PTHREAD_MUTEX_INITIALIZER;
 
 Logger::Logger() {}
 
@@ -95,16 +96,18 @@ void Logger::log(const std::string& message, const char* file, int line, LogLeve
 		return;
 
 	std::time_t t = std::time(NULL);
-	std::tm* localTime = std::localtime(&t);
+	std::tm localTime;
+	localtime_r(&t, &localTime);
 
 	char timeStr[9];
-	std::strftime(timeStr, sizeof(timeStr), "%H:%M:%S", localTime);
+	std::strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &localTime);
 	std::string colorStart = "";
 	std::string colorEnd = "";
 	if (useColour) {
 		colorStart = getColor(level);
 		colorEnd = "\033[0m";
 	}
+	pthread_mutex_lock(&mutex);
 	*output << colorStart;
 	if (useTimestamp)
 		*output << "[" << timeStr << "] ";
@@ -114,6 +117,7 @@ void Logger::log(const std::string& message, const char* file, int line, LogLeve
 	if (useFileLine)
 		*output << " [" << file << ":" << line << "]";
 	*output << std::endl;
+	pthread_mutex_unlock(&mutex);
 }
 
 
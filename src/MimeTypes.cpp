@@ -0,0 +1,86 @@
+#include "MimeTypes.hpp"
+
+#include <cctype>
+
+MimeTypes::MimeTypes() : slots(64), count(0), defaultType("application/octet-stream") {
+	const char* builtin[][2] = {
+		{"html", "text/html"}, {"htm", "text/html"}, {"css", "text/css"}, {"txt", "text/plain"},
+		{"csv", "text/csv"}, {"xml", "text/xml"}, {"js", "text/javascript"}, {"mjs", "text/javascript"},
+		{"json", "application/json"}, {"pdf", "application/pdf"}, {"zip", "application/zip"},
+		{"gz", "application/gzip"}, {"tar", "application/x-tar"}, {"wasm", "application/wasm"},
+		{"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"}, {"png", "image/png"}, {"gif", "image/gif"},
+		{"ico", "image/x-icon"}, {"svg", "image/svg+xml"}, {"webp", "image/webp"}, {"avif", "image/avif"},
+		{"mp3", "audio/mpeg"}, {"ogg", "audio/ogg"}, {"wav", "audio/wav"}, {"mp4", "video/mp4"},
+		{"webm", "video/webm"}, {"woff", "font/woff"}, {"woff2", "font/woff2"}, {"ttf", "font/ttf"},
+	};
+	for (size_t i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++)
+		add(builtin[i][0], builtin[i][1]);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Table                                   */
+/* -------------------------------------------------------------------------- */
+
+void MimeTypes::add(const std::string& extension, const std::string& type) {
+	if (extension.empty())
+		return;
+	if ((this->count + 1) * 2 > this->slots.size())
+		grow();
+	size_t index = find(extension.data(), extension.size());
+	if (this->slots[index].extension.empty()) {
+		for (size_t i = 0; i < extension.size(); i++)
+			this->slots[index].extension += std::tolower(static_cast<unsigned char>(extension[i]));
+		this->count++;
+	}
+	this->slots[index].type = type;
+}
+
+void MimeTypes::setDefaultType(const std::string& type) {
+	this->defaultType = type;
+}
+
+const std::string& MimeTypes::resolve(const std::string& path) const {
+	size_t dot = path.find_last_of("./");
+	if (dot == std::string::npos || path[dot] == '/' || dot + 1 == path.size())
+		return this->defaultType;
+	const Slot& slot = this->slots[find(path.data() + dot + 1, path.size() - dot - 1)];
+	return slot.extension.empty() ? this->defaultType : slot.type;
+}
+
+size_t MimeTypes::hash(const char* extension, size_t length) {
+	// FNV-1a over the lowercase characters
+	size_t value = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		value ^= std::tolower(static_cast<unsigned char>(extension[i]));
+		value *= 16777619u;
+	}
+	return value;
+}
+
+size_t MimeTypes::find(const char* extension, size_t length) const {
+	size_t mask = this->slots.size() - 1;
+	for (size_t index = hash(extension, length) & mask;; index = (index + 1) & mask) {
+		const std::string& stored = this->slots[index].extension;
+		if (stored.empty())
+			return index;
+		if (stored.size() != length)
+			continue;
+		size_t i = 0;
+		while (i < length && stored[i] == std::tolower(static_cast<unsigned char>(extension[i])))
+			i++;
+		if (i == length)
+			return index;
+	}
+}
+
+void MimeTypes::grow() {
+	std::vector<Slot> old(this->slots.size() * 2);
+	old.swap(this->slots);
+	for (size_t i = 0; i < old.size(); i++) {
+		if (old[i].extension.empty())
+			continue;
+		Slot& slot = this->slots[find(old[i].extension.data(), old[i].extension.size())];
+		slot.extension.swap(old[i].extension);
+		slot.type.swap(old[i].type);
+	}
+}
\ No newline at end of file
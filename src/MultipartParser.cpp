@@ -0,0 +1,207 @@
+#include "MultipartParser.hpp"
+#include "RequestParser.hpp"
+#include "Scan.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+MultipartParser::MultipartParser(const std::string& boundary, MultipartSink& sink) :
+	delimiter("\r\n--" + boundary),
+	state(MULTIPART_PREAMBLE),
+	pending("\r\n"),
+	sink(&sink)
+{
+	// The body starts without a line break, the one in `pending` lets the first delimiter match as well
+	size_t length = this->delimiter.size();
+	for (size_t i = 0; i < 256; i++)
+		this->skip[i] = length;
+	for (size_t i = 0; i + 1 < length; i++)
+		this->skip[static_cast<unsigned char>(this->delimiter[i])] = length - 1 - i;
+}
+
+MultipartParser::~MultipartParser() {}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Parsing                                  */
+/* -------------------------------------------------------------------------- */
+
+void MultipartParser::feed(const char* data, size_t length) {
+	size_t offset = 0;
+	// Bytes left over from the previous piece are completed with the start of this one first
+	while (!this->pending.empty() && offset < length) {
+		size_t carried = this->pending.size();
+		size_t taken = std::min(length - offset, static_cast<size_t>(MULTIPART_HEADER_LIMIT));
+		this->pending.append(data + offset, taken);
+		size_t consumed = process(this->pending.data(), this->pending.data() + this->pending.size());
+		if (consumed >= carried) {
+			offset += consumed - carried;
+			this->pending.clear();
+		} else {
+			this->pending.erase(0, consumed);
+			offset += taken;
+		}
+	}
+	if (this->pending.empty() && offset < length) {
+		size_t consumed = process(data + offset, data + length);
+		this->pending.assign(data + offset + consumed, data + length);
+	}
+}
+
+size_t MultipartParser::process(const char* begin, const char* end) {
+	const char* p = begin;
+	while (p < end) {
+		switch (this->state) {
+			case MULTIPART_PREAMBLE:
+			case MULTIPART_BODY: {
+				const char* found = findDelimiter(p, end);
+				if (found == end) {
+					// The tail might be the start of a delimiter that continues in the next piece
+					const char* safeEnd = end - std::min(static_cast<size_t>(end - p), this->delimiter.size() - 1);
+					if (this->state == MULTIPART_BODY)
+						this->sink->partData(p, safeEnd - p);
+					return safeEnd - begin;
+				}
+				if (this->state == MULTIPART_BODY) {
+					this->sink->partData(p, found - p);
+					this->sink->endPart();
+				}
+				p = found + this->delimiter.size();
+				this->state = MULTIPART_DELIMITER;
+				break;
+			}
+			case MULTIPART_DELIMITER:
+				// Transport padding may follow the delimiter (RFC 2046, section 5.1.1)
+				if (*p == ' ' || *p == '\t') {
+					p++;
+					break;
+				}
+				if (end - p < 2)
+					return p - begin;
+				if (p[0] == '-' && p[1] == '-') {
+					this->state = MULTIPART_DONE;
+				} else if (p[0] == '\r' && p[1] == '\n') {
+					p += 2;
+					this->state = MULTIPART_HEADERS;
+				} else {
+					this->state = MULTIPART_ERROR;
+				}
+				break;
+			case MULTIPART_HEADERS: {
+				if (end - p < 2)
+					return p - begin;
+				MultipartPart part;
+				if (p[0] == '\r' && p[1] == '\n') {
+					p += 2;
+				} else {
+					const char* headerEnd = Scan::findCRLFCRLF(p, end);
+					if (headerEnd == end) {
+						if (end - p > MULTIPART_HEADER_LIMIT)
+							this->state = MULTIPART_ERROR;
+						return p - begin;
+					}
+					parsePartHeaders(p, headerEnd, part);
+					p = headerEnd + 4;
+				}
+				this->sink->beginPart(part);
+				this->state = MULTIPART_BODY;
+				break;
+			}
+			default:
+				// The epilogue behind the closing delimiter and anything after an error is ignored
+				return end - begin;
+		}
+	}
+	return p - begin;
+}
+
+const char* MultipartParser::findDelimiter(const char* begin, const char* end) const {
+	size_t length = this->delimiter.size();
+	const char* needle = this->delimiter.data();
+	char last = needle[length - 1];
+	for (const char* p = begin; static_cast<size_t>(end - p) >= length; p += this->skip[static_cast<unsigned char>(p[length - 1])]) {
+		if (p[length - 1] == last && std::memcmp(p, needle, length - 1) == 0)
+			return p;
+	}
+	return end;
+}
+
+void MultipartParser::parsePartHeaders(const char* begin, const char* end, MultipartPart& part) {
+	std::string headers(begin, end);
+	size_t lineStart = 0;
+	while (lineStart < headers.size()) {
+		size_t lineEnd = headers.find("\r\n", lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = headers.size();
+		size_t colon = headers.find(':', lineStart);
+		if (colon < lineEnd) {
+			Slice name(lineStart, colon - lineStart);
+			size_t valueStart = headers.find_first_not_of(" \t", colon + 1);
+			std::string value;
+			if (valueStart < lineEnd)
+				value = headers.substr(valueStart, lineEnd - valueStart);
+			if (RequestParser::equalsIgnoreCase(headers, name, "Content-Disposition")) {
+				part.name = extractParameter(value, "name");
+				part.fileName = extractParameter(value, "filename");
+			} else if (RequestParser::equalsIgnoreCase(headers, name, "Content-Type")) {
+				part.contentType = value;
+			}
+		}
+		lineStart = lineEnd + 2;
+	}
+}
+
+std::string MultipartParser::extractParameter(const std::string& value, const std::string& key) {
+	size_t position = value.find(';');
+	while (position != std::string::npos) {
+		size_t keyStart = value.find_first_not_of(" \t", position + 1);
+		if (keyStart == std::string::npos)
+			break;
+		size_t equals = value.find('=', keyStart);
+		position = value.find(';', keyStart);
+		if (equals == std::string::npos || equals > position)
+			continue;
+		if (value.compare(keyStart, equals - keyStart, key) != 0)
+			continue;
+		size_t valueStart = equals + 1;
+		if (valueStart < value.size() && value[valueStart] == '"') {
+			size_t quote = value.find('"', valueStart + 1);
+			if (quote == std::string::npos)
+				return "";
+			return value.substr(valueStart + 1, quote - valueStart - 1);
+		}
+		size_t valueEnd = std::min(position, value.size());
+		return value.substr(valueStart, valueEnd - valueStart);
+	}
+	return "";
+}
+
+std::string MultipartParser::extractBoundary(const std::string& contentType) {
+	size_t boundaryPos = contentType.find("boundary=");
+	if (boundaryPos == std::string::npos) {
+		return "";
+	}
+
+	std::string boundary = contentType.substr(boundaryPos + 9);
+	size_t semicolonPos = boundary.find(";");
+	if (semicolonPos != std::string::npos) {
+		boundary = boundary.substr(0, semicolonPos);
+	}
+
+	// The boundary may be sent as a quoted string
+	if (boundary.size() >= 2 && boundary[0] == '"' && boundary[boundary.size() - 1] == '"') {
+		boundary = boundary.substr(1, boundary.size() - 2);
+	}
+	return boundary;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+bool MultipartParser::done() const {
+	return this->state == MULTIPART_DONE;
+}
+
+bool MultipartParser::failed() const {
+	return this->state == MULTIPART_ERROR;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "OutputQueue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/sendfile.h>
+
+OutputQueue::OutputQueue() : headOffset(0), memoryBytes(0), fileCount(0) {
+	std::memset(&this->message, 0, sizeof(this->message));
+}
+
+OutputQueue::~OutputQueue() {
+	while (!this->segments.empty())
+		popFront();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Queueing                                  */
+/* -------------------------------------------------------------------------- */
+
+void OutputQueue::append(const std::string& data) {
+	if (data.empty())
+		return;
+	this->segments.push_back(Segment());
+	this->segments.back().data = data;
+	this->memoryBytes += data.size();
+}
+
+void OutputQueue::append(const char* data, size_t length) {
+	if (length == 0)
+		return;
+	this->segments.push_back(Segment());
+	this->segments.back().data.assign(data, length);
+	this->memoryBytes += length;
+}
+
+void OutputQueue::take(std::string& data) {
+	if (data.empty())
+		return;
+	this->segments.push_back(Segment());
+	this->segments.back().data.swap(data);
+	this->memoryBytes += this->segments.back().data.size();
+}
+
+void OutputQueue::appendShared(SharedBuffer* buffer) {
+	if (buffer->str().empty())
+		return;
+	this->segments.push_back(Segment());
+	this->segments.back().shared = buffer->retain();
+	this->memoryBytes += buffer->str().size();
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t length) {
+	if (length == 0) {
+		close(fd);
+		return;
+	}
+	this->segments.push_back(Segment());
+	this->segments.back().fd = fd;
+	this->segments.back().offset = offset;
+	this->segments.back().length = length;
+	this->fileCount++;
+}
+
+bool OutputQueue::empty() const {
+	return this->segments.empty();
+}
+
+size_t OutputQueue::size() const {
+	return this->memoryBytes;
+}
+
+size_t OutputQueue::files() const {
+	return this->fileCount;
+}
+
+bool OutputQueue::frontIsFile() const {
+	return !this->segments.empty() && this->segments.front().fd != -1;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Sending                                  */
+/* -------------------------------------------------------------------------- */
+
+ssize_t OutputQueue::send(int socket) {
+	if (this->segments.empty())
+		return 0;
+	if (!frontIsFile()) {
+		struct msghdr* message = prepareMessage();
+		ssize_t sent = writev(socket, message->msg_iov, message->msg_iovlen);
+		if (sent > 0)
+			consume(sent);
+		return sent;
+	}
+	Segment& file = this->segments.front();
+	ssize_t sent = sendfile(socket, file.fd, &file.offset, file.length);
+	if (sent == 0) {
+		// The file was truncated after its length was announced, the response can not be completed
+		errno = EIO;
+		return -1;
+	}
+	if (sent > 0) {
+		file.length -= sent;
+		if (file.length == 0)
+			popFront();
+	}
+	return sent;
+}
+
+struct msghdr* OutputQueue::prepareMessage() {
+	this->iov.clear();
+	size_t offset = this->headOffset;
+	for (std::deque<Segment>::iterator it = this->segments.begin();
+		it != this->segments.end() && it->fd == -1 && this->iov.size() < OUTPUT_IOV_MAX; ++it) {
+		struct iovec vec;
+		vec.iov_base = const_cast<char*>(it->bytes().data() + offset);
+		vec.iov_len = it->bytes().size() - offset;
+		this->iov.push_back(vec);
+		offset = 0;
+	}
+	this->message.msg_iov = this->iov.empty() ? NULL : &this->iov[0];
+	this->message.msg_iovlen = this->iov.size();
+	return &this->message;
+}
+
+void OutputQueue::consume(size_t length) {
+	while (length > 0 && !this->segments.empty() && this->segments.front().fd == -1) {
+		size_t available = this->segments.front().bytes().size() - this->headOffset;
+		size_t used = std::min(length, available);
+		this->headOffset += used;
+		this->memoryBytes -= used;
+		length -= used;
+		if (used == available)
+			popFront();
+	}
+}
+
+void OutputQueue::popFront() {
+	Segment& front = this->segments.front();
+	if (front.fd != -1) {
+		close(front.fd);
+		this->fileCount--;
+	} else {
+		this->memoryBytes -= front.bytes().size() - this->headOffset;
+		if (front.shared)
+			front.shared->release();
+	}
+	this->headOffset = 0;
+	this->segments.pop_front();
+}
+
+void OutputQueue::swap(OutputQueue& other) {
+	this->segments.swap(other.segments);
+	std::swap(this->headOffset, other.headOffset);
+	std::swap(this->memoryBytes, other.memoryBytes);
+	std::swap(this->fileCount, other.fileCount);
+	this->iov.swap(other.iov);
+	std::swap(this->message, other.message);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "PollPoller.hpp"
+
+PollPoller::PollPoller() {}
+
+PollPoller::~PollPoller() {}
+
+size_t PollPoller::indexOf(int fd) const {
+	if (fd < 0 || static_cast<size_t>(fd) >= this->positions.size() || this->positions[fd] < 0)
+		return this->fds.size();
+	return this->positions[fd];
+}
+
+bool PollPoller::add(int fd, int events, bool) {
+	if (fd < 0)
+		return false;
+	if (indexOf(fd) == this->fds.size()) {
+		if (static_cast<size_t>(fd) >= this->positions.size())
+			this->positions.resize(fd + 1, -1);
+		this->positions[fd] = this->fds.size();
+		struct pollfd pfd = {fd, 0, 0};
+		this->fds.push_back(pfd);
+	}
+	return modify(fd, events);
+}
+
+bool PollPoller::modify(int fd, int events) {
+	size_t i = indexOf(fd);
+	if (i == this->fds.size())
+		return false;
+	this->fds[i].events = 0;
+	if (events & POLLER_READ)
+		this->fds[i].events |= POLLIN;
+	if (events & POLLER_WRITE)
+		this->fds[i].events |= POLLOUT;
+	return true;
+}
+
+void PollPoller::remove(int fd) {
+	size_t i = indexOf(fd);
+	if (i == this->fds.size())
+		return;
+	// Swap-remove: the last entry takes the freed position
+	this->fds[i] = this->fds.back();
+	this->positions[this->fds[i].fd] = i;
+	this->fds.pop_back();
+	this->positions[fd] = -1;
+}
+
+int PollPoller::wait(std::vector<PollerEvent>& ready, int timeout) {
+	ready.clear();
+	if (poll(this->fds.empty() ? NULL : &this->fds[0], this->fds.size(), timeout) < 0)
+		return -1;
+	for (size_t i = 0; i < this->fds.size(); i++) {
+		short revents = this->fds[i].revents;
+		if (revents == 0)
+			continue;
+		PollerEvent event = {this->fds[i].fd, 0};
+		if (revents & POLLIN)
+			event.events |= POLLER_READ;
+		if (revents & POLLOUT)
+			event.events |= POLLER_WRITE;
+		if (revents & POLLERR)
+			event.events |= POLLER_ERROR;
+		if (revents & POLLHUP)
+			event.events |= POLLER_HANGUP;
+		if (revents & POLLNVAL)
+			event.events |= POLLER_INVALID;
+		ready.push_back(event);
+	}
+	return ready.size();
+}
+
+bool PollPoller::isEdgeTriggered() const {
+	return false;
+}
+
+const char* PollPoller::name() const {
+	return "poll";
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "Poller.hpp"
+#include "PollPoller.hpp"
+#include "EpollPoller.hpp"
+#include "Logger.hpp"
+
+Poller* Poller::create(EventBackend backend) {
+#ifdef WEBSERV_HAS_EPOLL
+	if (backend == BACKEND_EPOLL || backend == BACKEND_IO_URING) {
+		EpollPoller* poller = new EpollPoller();
+		if (poller->isValid())
+			return poller;
+		delete poller;
+		WARNING("epoll is unavailable, falling back to poll()");
+	}
+#else
+	if (backend == BACKEND_EPOLL || backend == BACKEND_IO_URING)
+		WARNING("Webserv was built without epoll support, falling back to poll()");
+#endif
+	return new PollPoller();
+}
\ No newline at end of file
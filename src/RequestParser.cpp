@@ -0,0 +1,309 @@
+#include "RequestParser.hpp"
+#include "Scan.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+RequestParser::RequestParser() {
+	reset();
+}
+
+RequestParser::~RequestParser() {}
+
+void RequestParser::reset() {
+	this->state = PARSE_REQUEST_LINE;
+	this->lineStart = 0;
+	this->scanPosition = 0;
+	this->method = Slice();
+	this->uri = Slice();
+	this->version = Slice();
+	this->headers.clear();
+	this->bodyOffset = 0;
+	this->contentLength = 0;
+	this->chunked = false;
+	this->decoder.reset(static_cast<size_t>(-1));
+	this->chunkedBody.clear();
+	this->bodySink = NULL;
+	this->bodyReceived = 0;
+	this->errorStatus = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Parsing                                  */
+/* -------------------------------------------------------------------------- */
+
+ParseState RequestParser::parse(std::string& buffer) {
+	const char* data = buffer.data();
+	while (this->state == PARSE_REQUEST_LINE || this->state == PARSE_HEADERS) {
+		const char* end = data + buffer.size();
+		const char* newline = Scan::findByte(data + std::min(this->scanPosition, buffer.size()), end, '\n');
+		if (newline == end) {
+			this->scanPosition = buffer.size();
+			if (buffer.size() > REQUEST_HEADER_LIMIT)
+				return fail(431);
+			return this->state;
+		}
+		size_t newlinePos = newline - data;
+		size_t lineEnd = newlinePos;
+		if (lineEnd > this->lineStart && data[lineEnd - 1] == '\r')
+			lineEnd--;
+		if (this->state == PARSE_REQUEST_LINE) {
+			// Empty lines in front of a request are ignored (RFC 9112, section 2.2)
+			if (lineEnd != this->lineStart) {
+				if (!parseRequestLine(buffer, lineEnd))
+					return fail(400);
+				this->state = PARSE_HEADERS;
+			}
+		} else if (lineEnd == this->lineStart) {
+			this->bodyOffset = newlinePos + 1;
+			this->lineStart = this->bodyOffset;
+			this->scanPosition = this->bodyOffset;
+			int status = finishHeaders(buffer);
+			if (status != 0)
+				return fail(status);
+			this->state = PARSE_BODY;
+			return this->state;
+		} else if (!parseHeaderLine(buffer, lineEnd)) {
+			return fail(400);
+		}
+		this->lineStart = newlinePos + 1;
+		this->scanPosition = this->lineStart;
+		if (this->lineStart > REQUEST_HEADER_LIMIT)
+			return fail(431);
+	}
+	if (this->state == PARSE_BODY && this->bodySink)
+		return streamBody(buffer);
+	if (this->state == PARSE_BODY && this->chunked)
+		return parseChunkedBody(buffer);
+	if (this->state == PARSE_BODY && buffer.size() - this->bodyOffset >= this->contentLength)
+		this->state = PARSE_COMPLETE;
+	return this->state;
+}
+
+ParseState RequestParser::parseChunkedBody(std::string& buffer) {
+	size_t consumed = this->decoder.decode(buffer.data() + this->bodyOffset, buffer.size() - this->bodyOffset, this->chunkedBody);
+	buffer.erase(this->bodyOffset, consumed);
+	this->contentLength = this->chunkedBody.size();
+	if (this->decoder.failed())
+		return fail(this->decoder.getErrorStatus());
+	if (this->decoder.done())
+		this->state = PARSE_COMPLETE;
+	return this->state;
+}
+
+ParseState RequestParser::streamBody(std::string& buffer) {
+	if (this->chunked) {
+		parseChunkedBody(buffer);
+		this->bodySink->write(this->chunkedBody.data(), this->chunkedBody.size());
+		this->chunkedBody.clear();
+		this->contentLength = this->decoder.getDecodedLength();
+		return this->state;
+	}
+	size_t length = std::min(this->contentLength - this->bodyReceived, buffer.size() - this->bodyOffset);
+	this->bodySink->write(buffer.data() + this->bodyOffset, length);
+	buffer.erase(this->bodyOffset, length);
+	this->bodyReceived += length;
+	if (this->bodyReceived == this->contentLength)
+		this->state = PARSE_COMPLETE;
+	return this->state;
+}
+
+void RequestParser::setBodySink(BodySink* sink) {
+	this->bodySink = sink;
+}
+
+void RequestParser::reject(int status) {
+	fail(status);
+}
+
+void RequestParser::setBodyLimit(size_t maxBodySize) {
+	this->decoder.reset(maxBodySize);
+}
+
+bool RequestParser::parseRequestLine(const std::string& buffer, size_t lineEnd) {
+	const char* data = buffer.data();
+	size_t start = this->lineStart;
+	const char* space = static_cast<const char*>(std::memchr(data + start, ' ', lineEnd - start));
+	if (!space || space == data + start)
+		return false;
+	this->method = Slice(start, space - data - start);
+	start = space - data + 1;
+	space = static_cast<const char*>(std::memchr(data + start, ' ', lineEnd - start));
+	if (!space || space == data + start)
+		return false;
+	this->uri = Slice(start, space - data - start);
+	start = space - data + 1;
+	this->version = Slice(start, lineEnd - start);
+	if (this->version.length < 8 || std::memcmp(data + start, "HTTP/", 5) != 0)
+		return false;
+	// Methods are tokens (RFC 9110, section 9.1), the ones this server implements are upper case
+	const char* methodEnd = data + this->method.offset + this->method.length;
+	return Scan::findNonToken(data + this->method.offset, methodEnd) == methodEnd;
+}
+
+bool RequestParser::parseHeaderLine(const std::string& buffer, size_t lineEnd) {
+	const char* data = buffer.data();
+	// Obsolete line folding is rejected (RFC 9112, section 5.2)
+	if (data[this->lineStart] == ' ' || data[this->lineStart] == '\t')
+		return false;
+	// The field name is a token directly followed by the colon (RFC 9110, section 5.1)
+	const char* colon = Scan::findNonToken(data + this->lineStart, data + lineEnd);
+	if (colon == data + lineEnd || *colon != ':' || colon == data + this->lineStart)
+		return false;
+	size_t nameEnd = colon - data;
+	size_t valueStart = nameEnd + 1;
+	while (valueStart < lineEnd && (data[valueStart] == ' ' || data[valueStart] == '\t'))
+		valueStart++;
+	size_t valueEnd = lineEnd;
+	while (valueEnd > valueStart && (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t'))
+		valueEnd--;
+	HeaderSlice header;
+	header.name = Slice(this->lineStart, nameEnd - this->lineStart);
+	header.value = Slice(valueStart, valueEnd - valueStart);
+	this->headers.push_back(header);
+	return true;
+}
+
+int RequestParser::finishHeaders(const std::string& buffer) {
+	bool hasLength = false;
+	bool hasEncoding = false;
+	for (size_t i = 0; i < this->headers.size(); i++) {
+		const Slice& value = this->headers[i].value;
+		if (equalsIgnoreCase(buffer, this->headers[i].name, "Transfer-Encoding")) {
+			// Chunked is the only transfer coding this server implements (RFC 9112, section 6.1)
+			if (hasEncoding || !equalsIgnoreCase(buffer, value, "chunked"))
+				return 501;
+			hasEncoding = true;
+			continue;
+		}
+		if (!equalsIgnoreCase(buffer, this->headers[i].name, "Content-Length"))
+			continue;
+		if (value.length == 0)
+			return 400;
+		size_t length = 0;
+		for (size_t j = value.offset; j < value.offset + value.length; j++) {
+			char c = buffer[j];
+			if (c < '0' || c > '9' || length > (static_cast<size_t>(-1) - 9) / 10)
+				return 400;
+			length = length * 10 + (c - '0');
+		}
+		// Repeated Content-Length headers must agree (RFC 9110, section 8.6)
+		if (hasLength && length != this->contentLength)
+			return 400;
+		this->contentLength = length;
+		hasLength = true;
+	}
+	// A message with both framings is a smuggling attempt (RFC 9112, section 6.3)
+	if (hasEncoding && hasLength)
+		return 400;
+	this->chunked = hasEncoding;
+	return 0;
+}
+
+ParseState RequestParser::fail(int status) {
+	this->errorStatus = status;
+	this->state = PARSE_ERROR;
+	return this->state;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+ParseState RequestParser::getState() const {
+	return this->state;
+}
+
+bool RequestParser::headersComplete() const {
+	return this->state == PARSE_BODY || this->state == PARSE_COMPLETE;
+}
+
+int RequestParser::getErrorStatus() const {
+	return this->errorStatus;
+}
+
+Slice RequestParser::getMethod() const {
+	return this->method;
+}
+
+Slice RequestParser::getURI() const {
+	return this->uri;
+}
+
+Slice RequestParser::getVersion() const {
+	return this->version;
+}
+
+size_t RequestParser::getBodyOffset() const {
+	return this->bodyOffset;
+}
+
+size_t RequestParser::getContentLength() const {
+	return this->contentLength;
+}
+
+bool RequestParser::isChunked() const {
+	return this->chunked;
+}
+
+bool RequestParser::isBodyStreamed() const {
+	return this->bodySink != NULL;
+}
+
+const char* RequestParser::getBody(const std::string& buffer) const {
+	if (this->chunked)
+		return this->chunkedBody.data();
+	return buffer.data() + this->bodyOffset;
+}
+
+size_t RequestParser::getRequestLength() const {
+	// Chunks and streamed bodies were already removed from the buffer
+	if (this->chunked || this->bodySink)
+		return this->bodyOffset;
+	return this->bodyOffset + this->contentLength;
+}
+
+bool RequestParser::findHeader(const std::string& buffer, const char* name, Slice& value) const {
+	for (size_t i = 0; i < this->headers.size(); i++) {
+		if (equalsIgnoreCase(buffer, this->headers[i].name, name)) {
+			value = this->headers[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string RequestParser::getHeader(const std::string& buffer, const char* name) const {
+	Slice value;
+	if (!findHeader(buffer, name, value))
+		return "";
+	return str(buffer, value);
+}
+
+size_t RequestParser::getHeaderCount() const {
+	return this->headers.size();
+}
+
+const HeaderSlice& RequestParser::getHeaderAt(size_t index) const {
+	return this->headers[index];
+}
+
+std::string RequestParser::str(const std::string& buffer, const Slice& slice) {
+	return buffer.substr(slice.offset, slice.length);
+}
+
+bool RequestParser::equalsIgnoreCase(const std::string& buffer, const Slice& slice, const char* value) {
+	if (std::strlen(value) != slice.length)
+		return false;
+	for (size_t i = 0; i < slice.length; i++) {
+		char a = buffer[slice.offset + i];
+		char b = value[i];
+		if (a >= 'A' && a <= 'Z')
+			a += 'a' - 'A';
+		if (b >= 'A' && b <= 'Z')
+			b += 'a' - 'A';
+		if (a != b)
+			return false;
+	}
+	return true;
+}
\ No newline at end of file
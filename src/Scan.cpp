@@ -0,0 +1,305 @@
+#include "Scan.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#ifdef WEBSERV_HAS_SSE2
+# include <immintrin.h>
+#endif
+
+// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." / "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+static const bool tokenTable[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                   Scalar                                   */
+/* -------------------------------------------------------------------------- */
+
+static const char* scalarFindByte(const char* begin, const char* end, char c) {
+	const void* found = std::memchr(begin, c, end - begin);
+	return found ? static_cast<const char*>(found) : end;
+}
+
+static const char* scalarFindCRLFCRLF(const char* begin, const char* end) {
+	for (const char* p = begin; end - p >= 4; p++) {
+		p = scalarFindByte(p, end - 3, '\r');
+		if (p == end - 3)
+			break;
+		if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
+			return p;
+	}
+	return end;
+}
+
+static const char* scalarFindNonToken(const char* begin, const char* end) {
+	while (begin < end && tokenTable[static_cast<unsigned char>(*begin)])
+		begin++;
+	return begin;
+}
+
+static const char* scalarFindSubstring(const char* begin, const char* end, const char* needle, size_t needleLength) {
+	if (needleLength == 0)
+		return begin;
+	if (static_cast<size_t>(end - begin) < needleLength)
+		return end;
+	const char* last = end - needleLength + 1;
+	for (const char* p = begin; p < last; p++) {
+		p = scalarFindByte(p, last, needle[0]);
+		if (p == last)
+			break;
+		if (std::memcmp(p + 1, needle + 1, needleLength - 1) == 0)
+			return p;
+	}
+	return end;
+}
+
+#ifdef WEBSERV_HAS_SSE2
+
+/* -------------------------------------------------------------------------- */
+/*                                    SSE2                                    */
+/* -------------------------------------------------------------------------- */
+
+static inline __m128i sse2Load(const char* p) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// Bytes in [lo, hi]; bytes >= 0x80 compare as negative and never match
+static inline __m128i sse2InRange(__m128i v, char lo, char hi) {
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+static const char* sse2FindByte(const char* begin, const char* end, char c) {
+	const __m128i wanted = _mm_set1_epi8(c);
+	const char* p = begin;
+	for (; end - p >= 16; p += 16) {
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(sse2Load(p), wanted));
+		if (mask)
+			return p + __builtin_ctz(mask);
+	}
+	return scalarFindByte(p, end, c);
+}
+
+static const char* sse2FindCRLFCRLF(const char* begin, const char* end) {
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	const char* p = begin;
+	for (; end - p >= 19; p += 16) {
+		__m128i match = _mm_and_si128(_mm_cmpeq_epi8(sse2Load(p), cr), _mm_cmpeq_epi8(sse2Load(p + 1), lf));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(sse2Load(p + 2), cr));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(sse2Load(p + 3), lf));
+		unsigned mask = _mm_movemask_epi8(match);
+		if (mask)
+			return p + __builtin_ctz(mask);
+	}
+	return scalarFindCRLFCRLF(p, end);
+}
+
+static const char* sse2FindNonToken(const char* begin, const char* end) {
+	const __m128i dash = _mm_set1_epi8('-');
+	const char* p = begin;
+	for (; end - p >= 16; p += 16) {
+		__m128i v = sse2Load(p);
+		// Letters, digits and '-' cover almost every token, the rarer characters go through the table
+		__m128i common = _mm_or_si128(sse2InRange(v, 'a', 'z'), sse2InRange(v, 'A', 'Z'));
+		common = _mm_or_si128(common, _mm_or_si128(sse2InRange(v, '0', '9'), _mm_cmpeq_epi8(v, dash)));
+		unsigned mask = ~_mm_movemask_epi8(common) & 0xffff;
+		while (mask) {
+			const char* candidate = p + __builtin_ctz(mask);
+			if (!tokenTable[static_cast<unsigned char>(*candidate)])
+				return candidate;
+			mask &= mask - 1;
+		}
+	}
+	return scalarFindNonToken(p, end);
+}
+
+static const char* sse2FindSubstring(const char* begin, const char* end, const char* needle, size_t needleLength) {
+	if (needleLength < 2)
+		return needleLength == 0 ? begin : sse2FindByte(begin, end, needle[0]);
+	// Compare the first and last byte of the needle at 16 positions at once, confirm candidates with memcmp
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+	const char* p = begin;
+	for (; end - p >= static_cast<ptrdiff_t>(needleLength + 15); p += 16) {
+		__m128i match = _mm_and_si128(_mm_cmpeq_epi8(sse2Load(p), first), _mm_cmpeq_epi8(sse2Load(p + needleLength - 1), last));
+		unsigned mask = _mm_movemask_epi8(match);
+		while (mask) {
+			const char* candidate = p + __builtin_ctz(mask);
+			if (std::memcmp(candidate + 1, needle + 1, needleLength - 2) == 0)
+				return candidate;
+			mask &= mask - 1;
+		}
+	}
+	return scalarFindSubstring(p, end, needle, needleLength);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    AVX2                                    */
+/* -------------------------------------------------------------------------- */
+
+// The kernels clear the upper halves of the ymm registers before they return or hand the tail to SSE2,
+// unoptimized builds do not insert `vzeroupper` and legacy SSE code after them pays for the transition
+# define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2Load(const char* p) {
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+AVX2 static inline __m256i avx2InRange(__m256i v, char lo, char hi) {
+	return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+AVX2 static const char* avx2FindByte(const char* begin, const char* end, char c) {
+	const __m256i wanted = _mm256_set1_epi8(c);
+	const char* p = begin;
+	for (; end - p >= 32; p += 32) {
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(avx2Load(p), wanted));
+		if (mask) {
+			_mm256_zeroupper();
+			return p + __builtin_ctz(mask);
+		}
+	}
+	_mm256_zeroupper();
+	return sse2FindByte(p, end, c);
+}
+
+AVX2 static const char* avx2FindCRLFCRLF(const char* begin, const char* end) {
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const char* p = begin;
+	for (; end - p >= 35; p += 32) {
+		__m256i match = _mm256_and_si256(_mm256_cmpeq_epi8(avx2Load(p), cr), _mm256_cmpeq_epi8(avx2Load(p + 1), lf));
+		match = _mm256_and_si256(match, _mm256_cmpeq_epi8(avx2Load(p + 2), cr));
+		match = _mm256_and_si256(match, _mm256_cmpeq_epi8(avx2Load(p + 3), lf));
+		unsigned mask = _mm256_movemask_epi8(match);
+		if (mask) {
+			_mm256_zeroupper();
+			return p + __builtin_ctz(mask);
+		}
+	}
+	_mm256_zeroupper();
+	return sse2FindCRLFCRLF(p, end);
+}
+
+AVX2 static const char* avx2FindNonToken(const char* begin, const char* end) {
+	const __m256i dash = _mm256_set1_epi8('-');
+	const char* p = begin;
+	for (; end - p >= 32; p += 32) {
+		__m256i v = avx2Load(p);
+		__m256i common = _mm256_or_si256(avx2InRange(v, 'a', 'z'), avx2InRange(v, 'A', 'Z'));
+		common = _mm256_or_si256(common, _mm256_or_si256(avx2InRange(v, '0', '9'), _mm256_cmpeq_epi8(v, dash)));
+		unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(common));
+		while (mask) {
+			const char* candidate = p + __builtin_ctz(mask);
+			if (!tokenTable[static_cast<unsigned char>(*candidate)]) {
+				_mm256_zeroupper();
+				return candidate;
+			}
+			mask &= mask - 1;
+		}
+	}
+	_mm256_zeroupper();
+	return sse2FindNonToken(p, end);
+}
+
+AVX2 static const char* avx2FindSubstring(const char* begin, const char* end, const char* needle, size_t needleLength) {
+	if (needleLength < 2)
+		return needleLength == 0 ? begin : avx2FindByte(begin, end, needle[0]);
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+	const char* p = begin;
+	for (; end - p >= static_cast<ptrdiff_t>(needleLength + 31); p += 32) {
+		__m256i match = _mm256_and_si256(_mm256_cmpeq_epi8(avx2Load(p), first), _mm256_cmpeq_epi8(avx2Load(p + needleLength - 1), last));
+		unsigned mask = _mm256_movemask_epi8(match);
+		while (mask) {
+			const char* candidate = p + __builtin_ctz(mask);
+			if (std::memcmp(candidate + 1, needle + 1, needleLength - 2) == 0) {
+				_mm256_zeroupper();
+				return candidate;
+			}
+			mask &= mask - 1;
+		}
+	}
+	_mm256_zeroupper();
+	return sse2FindSubstring(p, end, needle, needleLength);
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                                  Dispatch                                  */
+/* -------------------------------------------------------------------------- */
+
+static const ScanKernels scalarKernels = {scalarFindByte, scalarFindCRLFCRLF, scalarFindNonToken, scalarFindSubstring, "scalar"};
+#ifdef WEBSERV_HAS_SSE2
+static const ScanKernels sse2Kernels = {sse2FindByte, sse2FindCRLFCRLF, sse2FindNonToken, sse2FindSubstring, "sse2"};
+static const ScanKernels avx2Kernels = {avx2FindByte, avx2FindCRLFCRLF, avx2FindNonToken, avx2FindSubstring, "avx2"};
+#endif
+
+static const ScanKernels* selectKernels() {
+	const char* forced = std::getenv("WEBSERV_SCAN");
+	if (forced && Scan::kernels(forced))
+		return Scan::kernels(forced);
+	if (Scan::kernels("avx2"))
+		return Scan::kernels("avx2");
+	if (Scan::kernels("sse2"))
+		return Scan::kernels("sse2");
+	return &scalarKernels;
+}
+
+static const ScanKernels& getKernels() {
+	static const ScanKernels* kernels = selectKernels();
+	return *kernels;
+}
+
+const char* Scan::findByte(const char* begin, const char* end, char c) {
+	return getKernels().findByte(begin, end, c);
+}
+
+const char* Scan::findCRLFCRLF(const char* begin, const char* end) {
+	return getKernels().findCRLFCRLF(begin, end);
+}
+
+const char* Scan::findNonToken(const char* begin, const char* end) {
+	return getKernels().findNonToken(begin, end);
+}
+
+const char* Scan::findSubstring(const char* begin, const char* end, const char* needle, size_t needleLength) {
+	return getKernels().findSubstring(begin, end, needle, needleLength);
+}
+
+const char* Scan::variant() {
+	return getKernels().name;
+}
+
+const ScanKernels* Scan::kernels(const char* name) {
+	if (std::strcmp(name, "scalar") == 0)
+		return &scalarKernels;
+#ifdef WEBSERV_HAS_SSE2
+	if (std::strcmp(name, "sse2") == 0)
+		return &sse2Kernels;
+	__builtin_cpu_init();
+	if (std::strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+		return &avx2Kernels;
+#endif
+	return NULL;
+}
+
+bool Scan::isToken(unsigned char c) {
+	return tokenTable[c];
+}
\ No newline at end of file
@@ -1,14 +1,60 @@
 #include "SocketManager.hpp"
 
-bool g_run; 
+volatile sig_atomic_t g_run;
 
-SocketManager::SocketManager(const HTTPConfig& config): config(config) {}
+SocketManager::SocketManager(const HTTPConfig& config):
+	config(config),
+	poller(NULL),
+	ring(NULL),
+	fileCache(config.openFileCacheSize, config.openFileCacheValid, this->config.mimeTypes),
+	contentCache(config.staticCacheSize),
+	compression(this->config.gzip)
+{
+	for (std::vector<ServerConfig>::iterator it = this->config.serverConfigs.begin(); it != this->config.serverConfigs.end(); ++it) {
+		this->errorPages.push_back(new ErrorPages(*it));
+		it->errorPages = this->errorPages.back();
+	}
+	if (pipe(this->wakeupFds) < 0) {
+		this->wakeupFds[0] = -1;
+		this->wakeupFds[1] = -1;
+		throw std::runtime_error("Failed to create wakeup pipe");
+	}
+	fcntl(this->wakeupFds[0], F_SETFL, O_NONBLOCK);
+	fcntl(this->wakeupFds[1], F_SETFL, O_NONBLOCK);
+	fcntl(this->wakeupFds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(this->wakeupFds[1], F_SETFD, FD_CLOEXEC);
+	this->spareFd = open("/dev/null", O_RDONLY);
+	if (this->spareFd >= 0)
+		fcntl(this->spareFd, F_SETFD, FD_CLOEXEC);
+}
 
 SocketManager::~SocketManager() {
 	INFO("Closing all sockets");
-	for (size_t i = 0; i < this->fds.size(); i++) {
-		closeConnection(this->fds[i].fd);
+	while (!this->clientStates.empty())
+		closeConnection(this->clientStates.fdAt(0));
+	while (!this->server_fds.empty())
+		closeConnection(this->server_fds[0]);
+	delete this->poller;
+#ifdef WEBSERV_HAS_IO_URING
+	delete this->ring;
+	// Only freed once the ring is gone, the kernel may still have been reading from them
+	for (std::map<uint64_t, OutputQueue*>::iterator it = this->orphanedSends.begin(); it != this->orphanedSends.end(); ++it)
+		delete it->second;
+#endif
+	close(this->wakeupFds[0]);
+	close(this->wakeupFds[1]);
+	if (this->contentCache.getNotifyFd() != -1) {
+		INFO("Static content cache: " << this->contentCache.getHits() << " hits, " << this->contentCache.getMisses()
+			<< " misses, " << this->contentCache.getEvictions() << " evictions");
 	}
+	if (this->compression.getBytesIn() > 0) {
+		INFO("Compression: " << this->compression.getBytesIn() << " bytes compressed to " << this->compression.getBytesOut()
+			<< " in " << this->compression.getSeconds() * 1000 << " ms, " << this->compression.getHits() << " cached variants used");
+	}
+	if (this->spareFd >= 0)
+		close(this->spareFd);
+	for (size_t i = 0; i < this->errorPages.size(); i++)
+		delete this->errorPages[i];
 }
 
 /* -------------------------------------------------------------------------- */
@@ -39,80 +85,498 @@ void errnoPoll(){
 	}
 }
 
-void SocketManager::pollin(pollfd &fd) {
-	INFO("Recived a request on a socket *" << fd.fd << "*");
-	if (isServerSocket(fd.fd)) {
-		acceptNewConnections(fd.fd);
+void SocketManager::pollin(int fd) {
+	INFO("Recived a request on a socket *" << fd << "*");
+	if (isServerSocket(fd)) {
+		acceptNewConnections(fd);
 	} else {
-		time(&clientStates[fd.fd].lastActivity);
-		clientStates[fd.fd].responding = true;
-		if (readClientData(fd.fd)) {
-			fd.events |= POLLOUT;
-			processRequest(fd.fd);
-		}
+		clientStates[fd].responding = true;
+		touchClient(fd);
+		if (readClientData(fd))
+			dispatchRequest(fd);
 	}
 }
-void SocketManager::pollout(pollfd &fd) {
-	if (clientStates[fd.fd].hasForked){
-		processCGI(checkAndHandleChildProcess(clientStates[fd.fd]), fd.fd);
-	} else {
-		INFO("Sending response back to client from socket *" << fd.fd << "*");
-		time(&clientStates[fd.fd].lastActivity);
-		sendResponse(fd);
+
+void SocketManager::pollout(int fd) {
+	INFO("Sending response back to client from socket *" << fd << "*");
+	touchClient(fd);
+	sendResponse(fd);
+}
+
+void SocketManager::pollerr(int fd, int events) {
+	if (events & POLLER_ERROR)
+		WARNING("POLLERR : operation on the file descriptor failed unexpectedly on socket *" << fd << "*");
+	if (events & POLLER_HANGUP)
+		WARNING("POLLHUP : client closed the connection on socket *" << fd << "*");
+	if (events & POLLER_INVALID)
+		WARNING("POLLNVAL : file descriptor is not open or invalid on socket *" << fd << "*");
+	clientStates[fd].closeConnection = true;
+}
+
+void SocketManager::handleEvent(const PollerEvent& event) {
+	if (event.fd == this->wakeupFds[0]) {
+		char buffer[64];
+		while (read(this->wakeupFds[0], buffer, sizeof(buffer)) > 0)
+			;
+		return;
+	}
+	if (event.fd == this->contentCache.getNotifyFd()) {
+		handleFileChanges();
+		return;
+	}
+	if (isServerSocket(event.fd)) {
+		if (event.events & POLLER_READ)
+			pollin(event.fd);
+		return;
+	}
+	std::map<int, int>::iterator cgi = this->cgiFds.find(event.fd);
+	if (cgi != this->cgiFds.end()) {
+		handleCGIEvent(event.fd, cgi->second);
+		return;
+	}
+	if (!this->clientStates.find(event.fd))
+		return;
+	if (event.events & POLLER_READ)
+		pollin(event.fd);
+	if (event.events & (POLLER_ERROR | POLLER_HANGUP | POLLER_INVALID))
+		pollerr(event.fd, event.events);
+	if (!clientStates[event.fd].closeConnection && (event.events & POLLER_WRITE))
+		pollout(event.fd);
+	if (clientStates[event.fd].closeConnection)
+		closeConnection(event.fd);
+}
+
+void SocketManager::handleFileChanges() {
+	std::vector<std::string> changed;
+	this->contentCache.processEvents(changed);
+	for (size_t i = 0; i < changed.size(); i++)
+		this->fileCache.invalidate(changed[i]);
+}
+
+void SocketManager::checkCGIClients() {
+	for (std::set<int>::iterator it = this->cgiClients.begin(); it != this->cgiClients.end();) {
+		int fd = *it++;
+		finishCGI(fd);
+		if (this->clientStates[fd].closeConnection)
+			closeConnection(fd);
+	}
+}
+
+void SocketManager::checkTimeouts() {
+	std::vector<int> expired;
+	this->timers.expire(expired);
+	for (size_t i = 0; i < expired.size(); i++) {
+		int fd = expired[i];
+		ClientState* client = this->clientStates.find(fd);
+		if (!client)
+			continue;
+		ServerConfig& server = getTimeoutServer(*client);
+		uint64_t idle = this->timers.now() - client->lastActivity;
+		if (client->responding && !client->killTheChild && idle >= static_cast<uint64_t>(server.sendTimeout) * 1000) {
+			WARNING("Send timeout on socket *" << fd << "*");
+			client->killTheChild = true;
+			if (client->hasForked) {
+				WARNING("CGI process timed out");
+				stopCGI(fd);
+				if (client->cgiStreaming) {
+					endCGIStream(fd, false);
+				} else {
+					processCGI("CGI timeout", fd);
+					dispatchRequest(fd);
+				}
+			}
+		}
+		if (idle >= static_cast<uint64_t>(server.keepAliveTimeout) * 1000) {
+			WARNING("Keep-alive timeout on socket *" << fd << "*");
+			client->closeConnection = true;
+		}
+		if (client->closeConnection)
+			closeConnection(fd);
+		else
+			armTimer(fd, *client);
 	}
 }
 
-void SocketManager::pollerr(pollfd &fd) {
-	if (fd.revents & (POLLERR))
-		WARNING("POLLERR : operation on the file descriptor failed unexpectedly on socket *" << fd.fd << "*");
-	if (fd.revents & (POLLHUP))
-		WARNING("POLLHUP : client closed the connection on socket *" << fd.fd << "*");
-	if (fd.revents & (POLLNVAL))
-		WARNING("POLLNVAL : file descriptor is not open or invalid on socket *" << fd.fd << "*");
-	clientStates[fd.fd].closeConnection = true;
+void SocketManager::touchClient(int fd) {
+	ClientState& client = this->clientStates[fd];
+	client.lastActivity = this->timers.now();
+	armTimer(fd, client);
 }
 
+void SocketManager::armTimer(int fd, ClientState& client) {
+	ServerConfig& server = getTimeoutServer(client);
+	uint64_t deadline = client.lastActivity + static_cast<uint64_t>(server.keepAliveTimeout) * 1000;
+	if (client.responding && !client.killTheChild)
+		deadline = std::min(deadline, client.lastActivity + static_cast<uint64_t>(server.sendTimeout) * 1000);
+	this->timers.schedule(fd, deadline);
+}
 
 void SocketManager::run() {
-	if (this->fds.size() == 0) {
+	if (this->server_fds.size() == 0) {
 		ERROR("No servers configured, cannot run poll()!");
 		return;
 	}
 	g_run = true;
 	signal(SIGINT, stopServer);
-	INFO("Running poll()");
+	signal(SIGTERM, stopServer);
+	// sendfile() has no MSG_NOSIGNAL, a client that went away is noticed through EPIPE instead
+	signal(SIGPIPE, SIG_IGN);
+	// Here and not in the constructor, every worker process needs its own watches
+	this->contentCache.start();
+	if (this->config.eventBackend == BACKEND_IO_URING && setupRing())
+		runRing();
+	else
+		runPoller();
+}
+
+int SocketManager::nextTimeout() const {
+	return this->timers.nextTimeout(this->cgiClients.empty() ? this->config.server_timeout_time : CGI_CHECK_INTERVAL);
+}
+
+void SocketManager::runPoller() {
+	this->poller = Poller::create(this->config.eventBackend);
+	int listenEvents = this->config.workerProcesses > 1 ? POLLER_READ | POLLER_EXCLUSIVE : POLLER_READ;
+	for (size_t i = 0; i < this->server_fds.size(); i++) {
+		if (!this->poller->add(this->server_fds[i], listenEvents, false))
+			ERROR("Failed to watch server socket *" << this->server_fds[i] << "*");
+	}
+	this->poller->add(this->wakeupFds[0], POLLER_READ, false);
+	if (this->contentCache.getNotifyFd() != -1)
+		this->poller->add(this->contentCache.getNotifyFd(), POLLER_READ, false);
+	INFO("Running " << this->poller->name() << "()");
+	std::vector<PollerEvent> ready;
 	while (g_run) {
-		if (poll(&this->fds[0], this->fds.size(), this->config.server_timeout_time) < 0) {
+		int result = this->poller->wait(ready, nextTimeout());
+		this->timers.updateClock();
+		if (result < 0) {
 			errnoPoll();
 			continue;
 		}
-		for (size_t i = 0; i < this->fds.size(); i++) {
-			if (this->fds[i].revents & POLLIN)
-				pollin(fds[i]);
-			if (this->fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
-				pollerr(fds[i]);
-			if (!isServerSocket(this->fds[i].fd)) {
-				if (this->fds[i].revents & POLLOUT)
-					pollout(fds[i]);
-				time_t now;
-				time(&now);
-				if (clientStates[fds[i].fd].assignedConfig && clientStates[fds[i].fd].responding && difftime(now, clientStates[fds[i].fd].lastActivity) > clientStates[fds[i].fd].serverConfig.sendTimeout){
-					WARNING("Send timeout on socket *" << fds[i].fd << "*");
-					clientStates[fds[i].fd].killTheChild = true;
-				}
-				if (clientStates[fds[i].fd].assignedConfig && difftime(now, clientStates[fds[i].fd].lastActivity) > clientStates[fds[i].fd].serverConfig.keepAliveTimeout){
-					WARNING("Keep-alive timeout on socket *" << fds[i].fd << "*");
-					clientStates[fds[i].fd].closeConnection = true;
-				}
-				if (clientStates[fds[i].fd].closeConnection == true){
-					closeConnection(this->fds[i].fd);
-					i--;
-				}
-			}
+		for (size_t i = 0; i < ready.size(); i++)
+			handleEvent(ready[i]);
+		checkCGIClients();
+		checkTimeouts();
+	}
+}
+
+void SocketManager::wakeup() {
+	char byte = 0;
+	if (write(this->wakeupFds[1], &byte, 1) < 0)
+		WARNING("Failed to wake up event loop");
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               io_uring Backend                             */
+/* -------------------------------------------------------------------------- */
+
+#ifdef WEBSERV_HAS_IO_URING
+
+enum RingOperation {
+	RING_ACCEPT = 1,
+	RING_RECV,
+	RING_SEND,
+	RING_WRITABLE,
+	RING_WAKEUP,
+	RING_FILE_CHANGES,
+	RING_CGI,
+	RING_CANCEL,
+};
+
+bool SocketManager::setupRing() {
+	this->ring = new IoUring();
+	if (!this->ring->setup(RING_ENTRIES) || !this->ring->setupBuffers(0, RING_BUFFER_COUNT, RING_BUFFER_SIZE)) {
+		WARNING("io_uring is unavailable, falling back to epoll");
+		delete this->ring;
+		this->ring = NULL;
+		return false;
+	}
+	this->multishotRecv = true;
+	return true;
+}
+
+void SocketManager::runRing() {
+	for (size_t i = 0; i < this->server_fds.size(); i++)
+		submitAccept(this->server_fds[i]);
+	submitWakeup();
+	if (this->contentCache.getNotifyFd() != -1)
+		submitFileChanges();
+	INFO("Running io_uring");
+	while (g_run) {
+		if (this->ring->submitAndWait(nextTimeout()) < 0 && errno != EINTR)
+			ERROR("io_uring_enter() failed: " << std::strerror(errno));
+		this->timers.updateClock();
+		struct io_uring_cqe* cqe;
+		while ((cqe = this->ring->peek()) != NULL) {
+			struct io_uring_cqe completion = *cqe;
+			this->ring->advance();
+			handleCompletion(completion);
+		}
+		checkCGIClients();
+		checkTimeouts();
+	}
+}
+
+uint64_t SocketManager::ringData(int operation, int fd) {
+	if (static_cast<size_t>(fd) >= this->ringGenerations.size())
+		this->ringGenerations.resize(fd + 1, 0);
+	return (static_cast<uint64_t>(operation) << 56)
+		| (static_cast<uint64_t>(this->ringGenerations[fd] & 0xffffff) << 32)
+		| static_cast<uint32_t>(fd);
+}
+
+void SocketManager::retireRingFd(int fd) {
+	ClientState* client = this->clientStates.find(fd);
+	if (client) {
+		shutdown(fd, SHUT_RDWR);
+		// The kernel may still read from the queued segments until the send completes, unless it only waits for POLLOUT
+		if (client->sendInFlight && !client->output.frontIsFile()) {
+			OutputQueue* orphan = new OutputQueue();
+			orphan->swap(client->output);
+			this->orphanedSends[ringData(RING_SEND, fd)] = orphan;
+		}
+	}
+	ringData(0, fd);
+	this->ringGenerations[fd]++;
+	for (size_t i = 0; i < this->pausedAccepts.size(); i++) {
+		if (this->pausedAccepts[i] != fd && g_run)
+			submitAccept(this->pausedAccepts[i]);
+	}
+	this->pausedAccepts.clear();
+}
+
+void SocketManager::submitAccept(int serverFd) {
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = serverFd;
+	sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->user_data = ringData(RING_ACCEPT, serverFd);
+}
+
+void SocketManager::submitRecv(int fd) {
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = this->ring->getBufferGroup();
+	sqe->ioprio = this->multishotRecv ? IORING_RECV_MULTISHOT : 0;
+	sqe->user_data = ringData(RING_RECV, fd);
+	this->clientStates[fd].recvArmed = true;
+}
+
+void SocketManager::cancelRecv(int fd) {
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = ringData(RING_RECV, fd);
+	sqe->user_data = ringData(RING_CANCEL, fd);
+}
+
+void SocketManager::submitSend(int fd) {
+	ClientState& client = this->clientStates[fd];
+	if (client.sendInFlight)
+		return;
+	if (client.output.empty()) {
+		WARNING("Nothing to send on socket *" << fd << "*");
+		return;
+	}
+	if (client.output.frontIsFile()) {
+		submitWritable(fd);
+		return;
+	}
+	INFO("Sending response back to client from socket *" << fd << "*");
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<uintptr_t>(client.output.prepareMessage());
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = ringData(RING_SEND, fd);
+	client.sendInFlight = true;
+}
+
+void SocketManager::submitWritable(int fd) {
+	ClientState& client = this->clientStates[fd];
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = POLLOUT;
+	sqe->user_data = ringData(RING_WRITABLE, fd);
+	client.sendInFlight = true;
+}
+
+void SocketManager::submitWakeup() {
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = this->wakeupFds[0];
+	sqe->poll32_events = POLLIN;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = ringData(RING_WAKEUP, this->wakeupFds[0]);
+}
+
+void SocketManager::submitFileChanges() {
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = this->contentCache.getNotifyFd();
+	sqe->poll32_events = POLLIN;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = ringData(RING_FILE_CHANGES, this->contentCache.getNotifyFd());
+}
+
+void SocketManager::submitCGI(int cgiFd) {
+	struct io_uring_sqe* sqe = this->ring->getSqe();
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = cgiFd;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = ringData(RING_CGI, cgiFd);
+}
+
+void SocketManager::handleCompletion(const struct io_uring_cqe& cqe) {
+	int operation = cqe.user_data >> 56;
+	int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+	if (operation == RING_SEND) {
+		std::map<uint64_t, OutputQueue*>::iterator orphan = this->orphanedSends.find(cqe.user_data);
+		if (orphan != this->orphanedSends.end()) {
+			delete orphan->second;
+			this->orphanedSends.erase(orphan);
+			return;
+		}
+	}
+	if (cqe.user_data != ringData(operation, fd)) {
+		if (cqe.flags & IORING_CQE_F_BUFFER)
+			this->ring->recycleBuffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+		return;
+	}
+	switch (operation) {
+		case RING_ACCEPT:
+			ringAccepted(fd, cqe.res, cqe.flags);
+			break;
+		case RING_RECV:
+			ringReceived(fd, cqe.res, cqe.flags);
+			break;
+		case RING_SEND:
+			ringSent(fd, cqe.res);
+			break;
+		case RING_WRITABLE:
+			ringWritable(fd, cqe.res);
+			break;
+		case RING_WAKEUP: {
+			char buffer[64];
+			while (read(this->wakeupFds[0], buffer, sizeof(buffer)) > 0)
+				;
+			if (!(cqe.flags & IORING_CQE_F_MORE))
+				submitWakeup();
+			break;
+		}
+		case RING_FILE_CHANGES:
+			handleFileChanges();
+			if (!(cqe.flags & IORING_CQE_F_MORE))
+				submitFileChanges();
+			break;
+		case RING_CGI: {
+			std::map<int, int>::iterator cgi = this->cgiFds.find(fd);
+			if (cgi == this->cgiFds.end())
+				break;
+			int clientFd = cgi->second;
+			handleCGIEvent(fd, clientFd);
+			// Unless the descriptor was closed meanwhile, which also changes its generation, or the pipe was paused
+			ClientState* client = this->clientStates.find(clientFd);
+			if (this->cgiFds.count(fd) && cqe.user_data == ringData(RING_CGI, fd)
+				&& !(client && client->cgiPaused && fd == client->childFd[0]))
+				submitCGI(fd);
+			break;
 		}
 	}
 }
 
+void SocketManager::ringAccepted(int serverFd, int result, unsigned flags) {
+	if (result >= 0) {
+		addClient(serverFd, result);
+	} else if (result == -EMFILE || result == -ENFILE) {
+		shedConnection(serverFd);
+		// The ring reserves the descriptor before waiting for a connection, re-arming now would spin
+		if (!(flags & IORING_CQE_F_MORE))
+			this->pausedAccepts.push_back(serverFd);
+		return;
+	} else if (result != -EAGAIN && result != -EINTR) {
+		ERROR("Error accepting connection: " << std::strerror(-result));
+	}
+	if (!(flags & IORING_CQE_F_MORE) && g_run)
+		submitAccept(serverFd);
+}
+
+void SocketManager::ringReceived(int fd, int result, unsigned flags) {
+	if (result > 0) {
+		unsigned short bid = flags >> IORING_CQE_BUFFER_SHIFT;
+		INFO("Recived a request on a socket *" << fd << "*");
+		clientStates[fd].responding = true;
+		touchClient(fd);
+		clientStates[fd].readBuffer.append(this->ring->getBuffer(bid), result);
+		this->ring->recycleBuffer(bid);
+		dispatchRequest(fd);
+	} else if (result == 0) {
+		clientStates[fd].closeConnection = true;
+	} else if (result == -EINVAL && this->multishotRecv) {
+		WARNING("Multishot recv is not supported, using single shot recv");
+		this->multishotRecv = false;
+	} else if (result != -ENOBUFS && result != -ECANCELED) {
+		ERROR("Failed to read from recv()");
+		clientStates[fd].closeConnection = true;
+	}
+	ClientState& client = this->clientStates[fd];
+	if (!(flags & IORING_CQE_F_MORE))
+		client.recvArmed = false;
+	if (client.closeConnection)
+		closeConnection(fd);
+	else if (!client.recvArmed && !client.readPaused)
+		submitRecv(fd);
+}
+
+void SocketManager::ringSent(int fd, int result) {
+	ClientState& client = this->clientStates[fd];
+	client.sendInFlight = false;
+	if (result < 0) {
+		ERROR("Failed to send response for socket *" << fd << "*");
+		closeConnection(fd);
+		return;
+	}
+	touchClient(fd);
+	client.output.consume(result);
+	resumeCGI(client);
+	if (!client.output.empty()) {
+		submitSend(fd);
+		return;
+	}
+	finishResponse(fd);
+	if (client.closeConnection)
+		closeConnection(fd);
+}
+
+void SocketManager::ringWritable(int fd, int result) {
+	ClientState& client = this->clientStates[fd];
+	ssize_t sent = result;
+	while (sent >= 0 && client.output.frontIsFile())
+		sent = client.output.send(fd);
+	if (sent < 0 && result >= 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		touchClient(fd);
+		submitWritable(fd);
+		return;
+	}
+	// Continues like a completed send of zero bytes, which also picks up the rest of the output
+	ringSent(fd, sent < 0 ? -1 : 0);
+}
+
+#else
+
+bool SocketManager::setupRing() {
+	WARNING("Webserv was built without io_uring support, falling back to epoll");
+	return false;
+}
+
+void SocketManager::runRing() {}
+
+#endif
+
 /* -------------------------------------------------------------------------- */
 /*                               Set Up Sockets                               */
 /* -------------------------------------------------------------------------- */
@@ -134,11 +598,10 @@ void SocketManager::setupServerSockets() {
 		int sockfd = createAndBindSocket(this->config.serverConfigs[i].listenPort);
 		if (sockfd >= 0) {
 			ports.push_back(this->config.serverConfigs[i].listenPort);
-			struct pollfd pfd = {sockfd, POLLIN, 0};
-			this->fds.push_back(pfd);
 			this->server_fds.push_back(sockfd);
-			this->serverConfigs[sockfd] = this->config.serverConfigs[i];
-
+			if (static_cast<size_t>(sockfd) >= this->listenPorts.size())
+				this->listenPorts.resize(sockfd + 1, 0);
+			this->listenPorts[sockfd] = this->config.serverConfigs[i].listenPort;
 		}
 	}
 }
@@ -151,6 +614,11 @@ int SocketManager::createAndBindSocket(int port) {
 	}
 	int optval = 1;
 	setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+	if (this->config.workerThreads > 1 && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0) {
+		closeConnection(sockfd);
+		ERROR("Failed to set SO_REUSEPORT for port: " << port);
+		return -1;
+	}
 	if (fcntl(sockfd, F_SETFL, O_NONBLOCK | FD_CLOEXEC) < 0) {
 		closeConnection(sockfd);
 		ERROR("Failed to set to non blocking mode for socket: *" << sockfd << "*");
@@ -179,158 +647,492 @@ int SocketManager::createAndBindSocket(int port) {
 /* -------------------------------------------------------------------------- */
 
 void SocketManager::acceptNewConnections(int server_fd) {
-	sockaddr_in client_addr;
-	socklen_t clilen = sizeof(client_addr);
-	int newsockfd = accept(server_fd, (struct sockaddr*)&client_addr, &clilen);
-	if (newsockfd < 0) {
-		ERROR("Error accepting connection");
-		return;
-	}
-	this->clientStates[newsockfd] = ClientState();
-	fcntl(newsockfd, F_SETFL, O_NONBLOCK | FD_CLOEXEC);
-	struct pollfd new_pfd = {newsockfd, POLLIN, 0};
-	this->fds.push_back(new_pfd);
-	time(&this->clientStates[newsockfd].lastActivity);
-	this->clientStates[newsockfd].serverPort = this->serverConfigs[server_fd].listenPort;
+	for (int accepted = 0; accepted < this->config.acceptBatch;) {
+		sockaddr_in client_addr;
+		socklen_t clilen = sizeof(client_addr);
+#ifdef SOCK_NONBLOCK
+		int newsockfd = accept4(server_fd, (struct sockaddr*)&client_addr, &clilen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+		int newsockfd = accept(server_fd, (struct sockaddr*)&client_addr, &clilen);
+		if (newsockfd >= 0) {
+			fcntl(newsockfd, F_SETFL, O_NONBLOCK);
+			fcntl(newsockfd, F_SETFD, FD_CLOEXEC);
+		}
+#endif
+		if (newsockfd >= 0) {
+			addClient(server_fd, newsockfd);
+			accepted++;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return;
+		} else if (errno == EINTR || errno == ECONNABORTED) {
+			continue;
+		} else if (errno == EMFILE || errno == ENFILE) {
+			shedConnection(server_fd);
+			return;
+		} else {
+			ERROR("Error accepting connection: " << std::strerror(errno));
+			return;
+		}
+	}
+}
+
+void SocketManager::shedConnection(int server_fd) {
+	ERROR("Out of file descriptors, dropping a connection on server socket *" << server_fd << "*");
+	if (this->spareFd < 0)
+		return;
+	close(this->spareFd);
+	int fd = accept(server_fd, NULL, NULL);
+	if (fd >= 0)
+		close(fd);
+	this->spareFd = open("/dev/null", O_RDONLY);
+	if (this->spareFd >= 0)
+		fcntl(this->spareFd, F_SETFD, FD_CLOEXEC);
+}
+
+void SocketManager::addClient(int server_fd, int newsockfd) {
+	ClientState& client = this->clientStates.insert(newsockfd);
+	client.serverPort = this->listenPorts[server_fd];
+	touchClient(newsockfd);
+#ifdef WEBSERV_HAS_IO_URING
+	if (this->ring)
+		submitRecv(newsockfd);
+	else
+#endif
+		this->poller->add(newsockfd, POLLER_READ, true);
 	SUCCESS("Server socket *" << server_fd << "* Accepted new connection on socket *" << newsockfd << "*");
 }
 
 /* ----------------------------- Handle Requests ---------------------------- */
 
 bool SocketManager::readClientData(int fd) {
-	size_t size = 4096 * 4;
-	char buffer[size];
-	std::memset(buffer, 0, sizeof(buffer));
-	ssize_t bytesRead = recv(fd, buffer, size, 0);
-	if (bytesRead > 0) {
-		this->clientStates[fd].readBuffer.append(buffer, bytesRead);
-		if (!this->clientStates[fd].headersComplete) {
-			size_t headerEndPos = this->clientStates[fd].readBuffer.find("\r\n\r\n");
-			if (headerEndPos != std::string::npos) {
-				this->clientStates[fd].headersComplete = true;
-				this->clientStates[fd].headerEndIndex = headerEndPos + 4;
-				size_t startPos = this->clientStates[fd].readBuffer.find("Content-Length: ");
-				if (startPos != std::string::npos) {
-					startPos += 16;
-					size_t endPos = this->clientStates[fd].readBuffer.find("\r\n", startPos);
-					std::istringstream iss(this->clientStates[fd].readBuffer.substr(startPos, endPos - startPos));
-					iss >> this->clientStates[fd].contentLength;
-					this->clientStates[fd].totalRead = this->clientStates[fd].readBuffer.length() - this->clientStates[fd].headerEndIndex;
-				} else {
-					this->clientStates[fd].contentLength = 0;
-				}
-				startPos = this->clientStates[fd].readBuffer.find("Host: ");
-				std::string hostName;
-				if (startPos != std::string::npos) {
-					startPos += 6;
-					size_t endPos = this->clientStates[fd].readBuffer.find("\r\n", startPos);
-					std::istringstream iss(this->clientStates[fd].readBuffer.substr(startPos, endPos - startPos));
-					iss >> hostName;
-				}
-				clientStates[fd].serverConfig = getCurrentServer(hostName, clientStates[fd].serverPort);
-				clientStates[fd].assignedConfig = true;
-			}
-		} else {
-			this->clientStates[fd].totalRead += bytesRead;
+	char buffer[4096 * 4];
+	ssize_t bytesRead;
+	do {
+		bytesRead = recv(fd, buffer, sizeof(buffer), 0);
+		if (bytesRead > 0) {
+			ClientState& client = this->clientStates[fd];
+			client.readBuffer.append(buffer, bytesRead);
+			// A streamed body goes to its sink right away, so the buffer does not grow with the upload
+			if (client.parser.isBodyStreamed() && client.parser.getState() == PARSE_BODY)
+				client.parser.parse(client.readBuffer);
+		} else if (bytesRead == 0) {
+			this->clientStates[fd].closeConnection = true;
+			return false;
+		} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			ERROR("Failed to read from recv()");
+			this->clientStates[fd].closeConnection = true;
+			return false;
 		}
-		if (this->clientStates[fd].headersComplete && this->clientStates[fd].totalRead == this->clientStates[fd].contentLength) {
-			this->clientStates[fd].totalRead = 0;
-			this->clientStates[fd].headersComplete = false;
-			return true;
-		}
-	} else if (bytesRead == 0) {
-		this->clientStates[fd].closeConnection = true;
-	} else if (bytesRead < 0) {
-		ERROR("Failed to read from recv()");
-		this->clientStates[fd].closeConnection = true;
+	} while (bytesRead > 0 && this->poller->isEdgeTriggered()
+		&& !(isDispatchPaused(this->clientStates[fd]) && this->clientStates[fd].readBuffer.size() >= PIPELINE_READ_LIMIT));
+	return true;
+}
+
+bool SocketManager::parseClientData(int fd) {
+	ClientState& client = this->clientStates[fd];
+	bool hadHeaders = client.parser.headersComplete();
+	ParseState state = client.parser.parse(client.readBuffer);
+	if (!hadHeaders && client.parser.headersComplete()) {
+		std::string hostName = client.parser.getHeader(client.readBuffer, "Host");
+		client.serverConfig = getCurrentServer(hostName, client.serverPort);
+		client.assignedConfig = true;
+		client.parser.setBodyLimit(client.serverConfig.clientMaxBodySize);
+		// An oversized body is refused before any of it is read
+		if (!client.parser.isChunked() && client.parser.getContentLength() > client.serverConfig.clientMaxBodySize)
+			client.parser.reject(413);
+		else
+			startUpload(client);
+		state = client.parser.parse(client.readBuffer);
 	}
-	return false;
+	client.contentLength = client.parser.getContentLength();
+	return state == PARSE_COMPLETE || state == PARSE_ERROR;
+}
+
+void SocketManager::dispatchRequest(int fd) {
+	ClientState& client = this->clientStates[fd];
+	while (!isDispatchPaused(client) && parseClientData(fd)) {
+		client.responding = true;
+		processRequest(fd);
+	}
+	if (!client.output.empty())
+		watchWrite(fd, true);
+	updateReadPause(fd);
+}
+
+bool SocketManager::isDispatchPaused(const ClientState& client) {
+	// A response without keep-alive that is still waiting in the output queue ends the connection
+	return client.hasForked || (!client.keepAlive && !client.output.empty())
+		|| client.output.size() >= PIPELINE_WRITE_LIMIT || client.output.files() >= PIPELINE_FILE_LIMIT;
+}
+
+void SocketManager::updateReadPause(int fd) {
+	ClientState& client = this->clientStates[fd];
+	bool pause = isDispatchPaused(client) && client.readBuffer.size() >= PIPELINE_READ_LIMIT;
+	if (pause == client.readPaused || client.closeConnection)
+		return;
+	client.readPaused = pause;
+	if (pause) {
+		WARNING("Pausing reads on socket *" << fd << "*, " << client.readBuffer.size() << " bytes wait to be processed");
+	}
+#ifdef WEBSERV_HAS_IO_URING
+	if (this->ring) {
+		// A single shot recv ends with its next completion and is not submitted again
+		if (pause && this->multishotRecv)
+			cancelRecv(fd);
+		else if (!pause && !client.recvArmed)
+			submitRecv(fd);
+		return;
+	}
+#endif
+	watchWrite(fd, !client.output.empty());
+}
+
+void SocketManager::startUpload(ClientState& client) {
+	const std::string& buffer = client.readBuffer;
+	if (RequestParser::str(buffer, client.parser.getMethod()) != "POST")
+		return;
+	std::string uri = RequestParser::str(buffer, client.parser.getURI());
+	uri = uri.substr(0, uri.find('?'));
+	// CGI scripts get the body in memory, see `processRequest()`
+	size_t dotPos = uri.find_last_of('.');
+	if (dotPos != std::string::npos && uri.substr(dotPos) == ".py")
+		return;
+	// Requests that are answered without storing anything keep their body in the buffer as before
+	if (!HTTPResponse::isMethodAllowed("POST", uri, client.serverConfig) || !HTTPResponse::isRedirection(uri, client.serverConfig).empty())
+		return;
+	client.upload = new Upload(client.serverConfig.rootDirectory, uri, client.parser.getHeader(buffer, "Content-Type"));
+	client.parser.setBodySink(client.upload);
+}
+
+void SocketManager::queueResponse(ClientState& client, HTTPResponse& response) {
+	if (response.getCached()) {
+		// The cached response starts after the status line and the `Date` header
+		std::string head;
+		response.appendStatusLine(head);
+		client.output.take(head);
+		client.output.appendShared(response.getCached());
+		return;
+	}
+	std::string data = response.convertHeadersToString();
+	client.output.take(data);
+	if (response.isHeadOnly())
+		return;
+	if (response.getSharedBody()) {
+		client.output.appendShared(response.getSharedBody());
+		return;
+	}
+	std::vector<FileBody> files;
+	response.releaseFiles(files);
+	for (size_t i = 0; i < files.size(); i++) {
+		client.output.take(files[i].header);
+		client.output.appendFile(files[i].fd, files[i].offset, files[i].remaining);
+	}
+	response.releaseBody(data);
+	client.output.take(data);
+}
+
+void SocketManager::consumeRequest(ClientState& client) {
+	if (client.parser.getState() == PARSE_COMPLETE)
+		client.readBuffer.erase(0, client.parser.getRequestLength());
+	else
+		client.readBuffer.clear();
+	client.parser.reset();
+	delete client.upload;
+	client.upload = NULL;
+}
+
+void SocketManager::finishResponse(int fd) {
+	ClientState& client = this->clientStates[fd];
+	SUCCESS("Response sent successfully on socket *" << fd << "*");
+	// The response of a CGI script pipelined behind the sent ones is still pending
+	if (client.hasForked)
+		return;
+	client.responding = false;
+	client.killTheChild = false;
+	if (client.keepAlive == false) {
+		WARNING("Non-keep-alive connection termination on socket *" << fd << "*");
+		client.closeConnection = true;
+		return;
+	}
+	dispatchRequest(fd);
 }
 
 /* Handle CGI */
 
-std::string SocketManager::handleCGI(ClientState& client, std::string& fullPath) {
-	std::string output;
-	if (!client.hasForked) {
-		INFO("Starting CGI - Forking process");
-		if (pipe(client.childFd) == -1) {
-			ERROR("Failed to create pipe");
-			return ("Internal server error");
-		}
-		client.childPid = fork();
-		if (client.childPid == -1) {
-			ERROR("Failed to fork");
-			close(client.childFd[0]);
-			close(client.childFd[1]);
-			return ("Internal server error");
-		} else if (client.childPid == 0) {
-			executeChild(client, fullPath);
-			return ("Internal server error");
-		} else {
-			close(client.childFd[1]);
-			client.hasForked = true;
-			return checkAndHandleChildProcess(client);
-		}
+std::string SocketManager::handleCGI(int fd, std::string& fullPath) {
+	ClientState& client = this->clientStates[fd];
+	INFO("Starting CGI - Forking process");
+	// Close-on-exec, so that scripts started meanwhile do not inherit the pipe and keep it open
+	if (pipe2(client.childFd, O_CLOEXEC) == -1) {
+		ERROR("Failed to create pipe");
+		return ("Internal server error");
+	}
+	client.childPid = fork();
+	if (client.childPid == -1) {
+		ERROR("Failed to fork");
+		close(client.childFd[0]);
+		close(client.childFd[1]);
+		client.childFd[0] = -1;
+		return ("Internal server error");
+	} else if (client.childPid == 0) {
+		executeChild(client, fullPath);
+		return ("Internal server error");
+	}
+	close(client.childFd[1]);
+	client.childFd[1] = -1;
+	fcntl(client.childFd[0], F_SETFL, O_NONBLOCK);
+	client.hasForked = true;
+	client.childExited = false;
+	client.cgiOutput.clear();
+	client.cgiHeaders.reset();
+	client.cgiStreaming = false;
+	client.cgiPaused = false;
+	client.pidFd = openPidFd(client.childPid);
+	if (!watchCGI(client.childFd[0], fd) || (client.pidFd != -1 && !watchCGI(client.pidFd, fd))) {
+		ERROR("Failed to watch CGI process");
+		stopCGI(fd);
+		client.hasForked = false;
+		return ("Internal server error");
+	}
+	return "";
+}
+
+int SocketManager::openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+	return syscall(SYS_pidfd_open, pid, 0);
+#else
+	(void)pid;
+	return -1;
+#endif
+}
+
+bool SocketManager::watchCGI(int cgiFd, int clientFd) {
+#ifdef WEBSERV_HAS_IO_URING
+	if (this->ring) {
+		submitCGI(cgiFd);
+		this->cgiFds[cgiFd] = clientFd;
+		return true;
+	}
+#endif
+	if (!this->poller->add(cgiFd, POLLER_READ, false))
+		return false;
+	this->cgiFds[cgiFd] = clientFd;
+	return true;
+}
+
+void SocketManager::unwatchCGI(int& cgiFd) {
+	if (cgiFd == -1)
+		return;
+	if (this->cgiFds.erase(cgiFd)) {
+		if (this->poller)
+			this->poller->remove(cgiFd);
+#ifdef WEBSERV_HAS_IO_URING
+		if (this->ring)
+			retireRingFd(cgiFd);
+#endif
+	}
+	close(cgiFd);
+	cgiFd = -1;
+}
+
+void SocketManager::handleCGIEvent(int cgiFd, int clientFd) {
+	ClientState& client = this->clientStates[clientFd];
+	if (cgiFd == client.childFd[0]) {
+		readCGIOutput(client);
+		if (client.cgiStreaming)
+			forwardCGIOutput(clientFd);
+		// A script that already finished is answered with a `Content-Length` instead
+		else if (client.childFd[0] != -1)
+			startCGIStream(clientFd);
 	} else {
-		return checkAndHandleChildProcess(client);
+		reapCGI(client);
 	}
+	finishCGI(clientFd);
+	if (this->clientStates[clientFd].closeConnection)
+		closeConnection(clientFd);
 }
 
-void SocketManager::processCGI(std::string stringCode, int fd) {
-	if (!stringCode.empty()){
-		try {
-			HTTPResponse response;
-			if (stringCode == "CGI timeout" || stringCode == "CGI script error" || stringCode == "Internal server error"){
-				response.assignGenericResponse(500, stringCode);
-			} else {
-				response.assignResponse(200, stringCode, "text/html");
-			}
-			this->clientStates[fd].writeBuffer = response.convertToString();
-			this->clientStates[fd].readBuffer.clear();
-			this->clientStates[fd].hasForked = false;
-		} catch (const std::runtime_error& e) {
-			ERROR(e.what());
-		}
+void SocketManager::readCGIOutput(ClientState& client) {
+	char buffer[16384];
+	ssize_t bytesRead = 0;
+	// Bounded, a script that writes without pause must not keep the event loop from the other clients
+	for (size_t total = 0; total < CGI_READ_LIMIT; total += bytesRead) {
+		bytesRead = read(client.childFd[0], buffer, sizeof(buffer));
+		if (bytesRead <= 0)
+			break;
+		client.cgiOutput.append(buffer, bytesRead);
 	}
+	if (bytesRead == 0 || (bytesRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+		unwatchCGI(client.childFd[0]);
 }
 
-std::string SocketManager::checkAndHandleChildProcess(ClientState& client) {
+void SocketManager::reapCGI(ClientState& client) {
 	int status;
+	pid_t result = waitpid(client.childPid, &status, WNOHANG);
+	if (result == 0)
+		return;
+	if (result == client.childPid) {
+		client.childStatus = status;
+	} else {
+		ERROR("waitpid returned unexpected result");
+		client.childStatus = -1;
+	}
+	client.childExited = true;
+	unwatchCGI(client.pidFd);
+}
+
+void SocketManager::finishCGI(int fd) {
+	ClientState& client = this->clientStates[fd];
+	if (!client.hasForked || client.childFd[0] != -1)
+		return;
+	if (!client.childExited)
+		reapCGI(client);
+	if (!client.childExited) {
+		// Without a pidfd the exit can only be polled for, the output is complete already
+		if (client.pidFd == -1)
+			this->cgiClients.insert(fd);
+		return;
+	}
+	this->cgiClients.erase(fd);
+	if (client.cgiStreaming) {
+		bool complete = client.childStatus != -1 && WIFEXITED(client.childStatus);
+		if (!complete)
+			ERROR("CGI script exited with error");
+		forwardCGIOutput(fd);
+		endCGIStream(fd, complete);
+		return;
+	}
 	std::string output;
-	char buffer[1024];
-	int bytesRead;
-	time_t now;
-	time(&now);
-	if (difftime(now, client.lastActivity) > client.serverConfig.sendTimeout) {
-		WARNING("CGI process timed out");
+	if (client.childStatus == -1) {
+		output = "Internal server error";
+	} else if (WIFEXITED(client.childStatus)) {
+		output.swap(client.cgiOutput);
+	} else {
+		ERROR("CGI script exited with error");
+		output = "CGI script error";
+	}
+	processCGI(output, fd);
+	dispatchRequest(fd);
+}
+
+void SocketManager::stopCGI(int fd) {
+	ClientState& client = this->clientStates[fd];
+	// Once reaped the pid may already belong to another process
+	if (!client.childExited) {
 		kill(client.childPid, SIGKILL);
-		waitpid(client.childPid, &status, 0);
-		close(client.childFd[0]);
-		output = "CGI timeout";
-		return(output);
+		waitpid(client.childPid, NULL, 0);
+		client.childExited = true;
 	}
-	pid_t result = waitpid(client.childPid, &status, WNOHANG);
-	if (result == 0) {
-		return output;
-	} if (result == client.childPid) {
-		if (WIFEXITED(status)) {
-			while ((bytesRead = read(client.childFd[0], buffer, sizeof(buffer) - 1)) > 0) {
-				output += buffer;
-				std::memset(buffer, 0, sizeof(buffer));
-			}
-			close(client.childFd[0]);
-			return(output);
+	unwatchCGI(client.childFd[0]);
+	unwatchCGI(client.pidFd);
+	client.cgiOutput.clear();
+	client.cgiPaused = false;
+	this->cgiClients.erase(fd);
+}
+
+void SocketManager::startCGIStream(int fd) {
+	ClientState& client = this->clientStates[fd];
+	CGIHeaderState state = client.cgiHeaders.parse(client.cgiOutput, false);
+	if (state == CGI_HEADERS_PENDING)
+		return;
+	if (state == CGI_HEADERS_INVALID) {
+		ERROR("CGI script sent an invalid header block");
+		stopCGI(fd);
+		processCGI("CGI script error", fd);
+		dispatchRequest(fd);
+		return;
+	}
+	HTTPResponse response;
+	response.assignCGIResponse(client.cgiHeaders, "");
+	response.setStreamed(client.cgiChunked);
+	queueResponse(client, response);
+	if (!client.cgiChunked)
+		client.keepAlive = false;
+	client.cgiOutput.erase(0, client.cgiHeaders.getBodyOffset());
+	client.cgiStreaming = true;
+	forwardCGIOutput(fd);
+}
+
+void SocketManager::forwardCGIOutput(int fd) {
+	ClientState& client = this->clientStates[fd];
+	if (client.cgiOutput.empty())
+		return;
+	if (client.cgiChunked) {
+		// The chunk size in hex, written backwards from the end of the buffer
+		char size[sizeof(size_t) * 2 + 2];
+		size_t start = sizeof(size);
+		size[--start] = '\n';
+		size[--start] = '\r';
+		size_t length = client.cgiOutput.size();
+		do {
+			size[--start] = "0123456789abcdef"[length & 0xf];
+			length >>= 4;
+		} while (length);
+		client.output.append(size + start, sizeof(size) - start);
+		client.output.take(client.cgiOutput);
+		client.output.append("\r\n", 2);
+	} else {
+		client.output.take(client.cgiOutput);
+	}
+	watchWrite(fd, true);
+	// Backpressure: a client that reads slower than the script writes stops the script at the full pipe
+	if (client.output.size() >= CGI_BUFFER_LIMIT && client.childFd[0] != -1 && !client.cgiPaused) {
+		client.cgiPaused = true;
+		if (this->poller)
+			this->poller->remove(client.childFd[0]);
+	}
+}
+
+void SocketManager::resumeCGI(ClientState& client) {
+	if (!client.cgiPaused || client.output.size() >= CGI_BUFFER_LIMIT / 2)
+		return;
+	client.cgiPaused = false;
+	if (client.childFd[0] == -1)
+		return;
+#ifdef WEBSERV_HAS_IO_URING
+	if (this->ring) {
+		submitCGI(client.childFd[0]);
+		return;
+	}
+#endif
+	this->poller->add(client.childFd[0], POLLER_READ, false);
+}
+
+void SocketManager::endCGIStream(int fd, bool complete) {
+	ClientState& client = this->clientStates[fd];
+	client.cgiStreaming = false;
+	client.hasForked = false;
+	if (complete && client.cgiChunked)
+		client.output.append("0\r\n\r\n");
+	// Without the last chunk the client can tell that the body is incomplete, the connection can not be reused
+	else
+		client.keepAlive = false;
+	if (client.output.empty())
+		finishResponse(fd);
+	else
+		watchWrite(fd, true);
+}
+
+void SocketManager::processCGI(std::string stringCode, int fd) {
+	ClientState& client = this->clientStates[fd];
+	client.hasForked = false;
+	try {
+		HTTPResponse response;
+		response.setErrorPages(client.serverConfig.errorPages);
+		if (client.gzip)
+			response.setCompression(&this->compression, client.encoding);
+		if (stringCode == "CGI timeout" || stringCode == "CGI script error" || stringCode == "Internal server error"){
+			response.assignGenericResponse(500, stringCode);
+		} else if (client.cgiHeaders.parse(stringCode, true) == CGI_HEADERS_INVALID) {
+			ERROR("CGI script sent an invalid header block");
+			response.assignGenericResponse(500, "CGI script error");
 		} else {
-			ERROR("CGI script exited with error");
-			close(client.childFd[0]);
-			output = "CGI script error";
-			return(output);
+			response.assignCGIResponse(client.cgiHeaders, stringCode.substr(client.cgiHeaders.getBodyOffset()));
 		}
-	} else {
-		ERROR("waitpid returned unexpected result");
-		close(client.childFd[0]);
-		output = "Internal server error";
-		return(output);
+		response.compressBody();
+		queueResponse(client, response);
+	} catch (const std::runtime_error& e) {
+		ERROR(e.what());
 	}
 }
 
@@ -354,6 +1156,8 @@ void SocketManager::executeChild(ClientState& client, std::string& fullPath) {
 	envp.push_back(envQuery.c_str());
 	envp.push_back(envRequestMethod.c_str());
 	envp.push_back("CONTENT_TYPE=text/html");
+	// Output is forwarded as it is written, Python would otherwise hold it back until its buffer is full
+	envp.push_back("PYTHONUNBUFFERED=1");
 	envp.push_back(NULL);
 	close(client.childFd[0]);
 	dup2(client.childFd[1], STDOUT_FILENO);
@@ -368,9 +1172,27 @@ void SocketManager::executeChild(ClientState& client, std::string& fullPath) {
 /* ---------------------------- Handle Responses ---------------------------- */
 
 void SocketManager::processRequest(int fd) {
-	HTTPRequest request(this->clientStates[fd].readBuffer);
+	if (this->clientStates[fd].parser.getState() == PARSE_ERROR) {
+		WARNING("Malformed request on socket *" << fd << "*");
+		HTTPResponse response;
+		if (this->clientStates[fd].assignedConfig)
+			response.setErrorPages(this->clientStates[fd].serverConfig.errorPages);
+		int status = this->clientStates[fd].parser.getErrorStatus();
+		if (status == 413 && !this->clientStates[fd].parser.isChunked()) {
+			WARNING("Body to big! serving 413!");
+			std::string payload = "Request has a body size of " + ::toString(clientStates[fd].contentLength) 
+				+ " bytes which exceeds the server body limit of " + ::toString(clientStates[fd].serverConfig.clientMaxBodySize) + " bytes!"; 
+			response.assignGenericResponse(413, payload);
+		} else {
+			response.assignGenericResponse(status);
+		}
+		this->clientStates[fd].keepAlive = false;
+		queueResponse(this->clientStates[fd], response);
+		consumeRequest(this->clientStates[fd]);
+		return;
+	}
+	HTTPRequest request(this->clientStates[fd].readBuffer, this->clientStates[fd].parser);
 	std::string stringCode = "go";
-	std::string keepAlive = request.getHeader("Connection");
 	std::string uri = request.getURI();
 	size_t queryPos = uri.find('?');
 	if (queryPos != std::string::npos) {
@@ -381,35 +1203,42 @@ void SocketManager::processRequest(int fd) {
 	if (dotPos != std::string::npos) {
 		extension = uri.substr(dotPos);
 	}
-	if (keepAlive == "keep-alive"){
-		this->clientStates[fd].keepAlive = true;
+	const std::string& buffer = this->clientStates[fd].readBuffer;
+	Slice connection;
+	bool hasConnection = this->clientStates[fd].parser.findHeader(buffer, "Connection", connection);
+	// HTTP/1.1 connections are persistent unless the client closes them (RFC 9112, section 9.3), which pipelining relies on
+	if (request.getVersion() == "HTTP/1.1") {
+		this->clientStates[fd].keepAlive = !hasConnection || !RequestParser::equalsIgnoreCase(buffer, connection, "close");
 	} else {
-		this->clientStates[fd].keepAlive = false;
+		this->clientStates[fd].keepAlive = hasConnection && RequestParser::equalsIgnoreCase(buffer, connection, "keep-alive");
 	}
-	if (clientStates[fd].contentLength > clientStates[fd].serverConfig.clientMaxBodySize){
-		stringCode = "413";
-	} else if (extension == ".py") { 
+	this->clientStates[fd].gzip = HTTPResponse::isGzipEnabled(uri, this->clientStates[fd].serverConfig);
+	this->clientStates[fd].encoding = Compression::negotiate(request.getHeader("Accept-Encoding"));
+	if (extension == ".py") { 
 		std::string fullPath = clientStates[fd].serverConfig.rootDirectory + request.getURI();
 		clientStates[fd].method = request.getMethod();
 		clientStates[fd].body = request.getBody();
+		clientStates[fd].cgiChunked = request.getVersion() == "HTTP/1.1";
 		if (!HTTPResponse::isMethodAllowed(clientStates[fd].method, uri, clientStates[fd].serverConfig)){
 			stringCode = "405";
 		} else if (request.getMethod() == "GET" || request.getMethod() == "POST") {
-			stringCode = handleCGI(clientStates[fd], fullPath);
+			stringCode = handleCGI(fd, fullPath);
 		} else {
 			stringCode = "405";
 		}
 	}
-	if (stringCode.empty())
+	// The CGI script is still running, it has copied everything it needs from the request
+	if (stringCode.empty()) {
+		consumeRequest(this->clientStates[fd]);
 		return;
+	}
 	try {
-		HTTPResponse response;
-		if (stringCode == "413"){
-			WARNING("Body to big! serving 413!");
-			std::string payload = "Request has a body size of " + ::toString(clientStates[fd].contentLength) 
-				+ " bytes which exceeds the server body limit of " + ::toString(clientStates[fd].serverConfig.clientMaxBodySize) + " bytes!"; 
-			response.assignGenericResponse(413, payload);
-		} else if (stringCode == "405"){
+		HTTPResponse response(&this->fileCache, &this->contentCache, &this->directoryCache);
+		response.setHeadOnly(request.getMethod() == "HEAD");
+		response.setErrorPages(this->clientStates[fd].serverConfig.errorPages);
+		if (this->clientStates[fd].gzip)
+			response.setCompression(&this->compression, this->clientStates[fd].encoding);
+		if (stringCode == "405"){
 			response.assignGenericResponse(405);
 		} else if (stringCode == "CGI timeout" || stringCode == "CGI script error" || stringCode == "Internal server error"){
 			response.assignGenericResponse(500, stringCode);
@@ -418,37 +1247,37 @@ void SocketManager::processRequest(int fd) {
 		} else {
 			response.assignResponse(200, stringCode, "text/html");
 		}
-		this->clientStates[fd].writeBuffer = response.convertToString();
-		this->clientStates[fd].readBuffer.clear();
+		response.compressBody();
+		queueResponse(this->clientStates[fd], response);
 		this->clientStates[fd].hasForked = false;
 	} catch (const std::runtime_error& e) {
 		ERROR(e.what());
 	}
+	consumeRequest(this->clientStates[fd]);
 }
 
-void SocketManager::sendResponse(pollfd &fd) {
-	if (this->clientStates[fd.fd].writeBuffer.empty()) {
-		WARNING("Nothing to send on socket *" << fd.fd << "*");
-		fd.events = POLLIN;
+void SocketManager::sendResponse(int fd) {
+	ClientState& client = this->clientStates[fd];
+	if (client.output.empty()) {
+		WARNING("Nothing to send on socket *" << fd << "*");
+		watchWrite(fd, false);
 		return;
 	}
-	ssize_t bytesWritten = send(fd.fd, this->clientStates[fd.fd].writeBuffer.c_str(), this->clientStates[fd.fd].writeBuffer.size(), 0);
+	ssize_t bytesWritten;
+	do {
+		bytesWritten = client.output.send(fd);
+	} while (bytesWritten > 0 && !client.output.empty() && this->poller->isEdgeTriggered());
 	if (bytesWritten > 0) {
-		this->clientStates[fd.fd].writeBuffer.erase(0, bytesWritten);
-		if (this->clientStates[fd.fd].writeBuffer.empty()) {
-			clientStates[fd.fd].responding = false;
-			fd.events = POLLIN;
-			SUCCESS("Response sent successfully on socket *" << fd.fd << "*");
-			if (this->clientStates[fd.fd].keepAlive == false) {
-				WARNING("Non-keep-alive connection termination on socket *" << fd.fd << "*");
-				this->clientStates[fd.fd].closeConnection = true;
-			}
+		resumeCGI(client);
+		if (client.output.empty()) {
+			watchWrite(fd, false);
+			finishResponse(fd);
 		}
 	} else if (bytesWritten == 0) {
-		WARNING("No data was sent for socket *" << fd.fd << "*");
-	} else {
-		ERROR("Failed to send response for socket *" << fd.fd << "*");
-		this->clientStates[fd.fd].closeConnection = true;
+		WARNING("No data was sent for socket *" << fd << "*");
+	} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+		ERROR("Failed to send response for socket *" << fd << "*");
+		client.closeConnection = true;
 	}
 }
 
@@ -479,27 +1308,46 @@ ServerConfig& SocketManager::getCurrentServer(std::string &hostName, int port) {
 
 void SocketManager::closeConnection(int fd) {
 	INFO("Closing socket: " << fd);
+	if (this->poller)
+		this->poller->remove(fd);
+#ifdef WEBSERV_HAS_IO_URING
+	if (this->ring)
+		retireRingFd(fd);
+#endif
 	close(fd);
-	for (std::vector<struct pollfd>::iterator it = this->fds.begin(); it != this->fds.end();) {
-		if (it->fd == fd) {
-			it = this->fds.erase(it);
-		} else {
-			++it;
-		}
+	this->timers.cancel(fd);
+	if (isServerSocket(fd)) {
+		this->server_fds.erase(std::find(this->server_fds.begin(), this->server_fds.end(), fd));
+		this->listenPorts[fd] = 0;
+		return;
 	}
-	for (std::vector<int>::iterator it = this->server_fds.begin(); it != this->server_fds.end();) {
-		if (*it == fd) {
-			it = this->server_fds.erase(it);
-		} else {
-			++it;
-		}
+	ClientState* client = this->clientStates.find(fd);
+	if (client) {
+		if (client->hasForked)
+			stopCGI(fd);
+		this->clientStates.erase(fd);
 	}
-	std::map<int, ClientState>::iterator it = this->clientStates.find(fd);
-	if (it != this->clientStates.end()) {
-		this->clientStates.erase(it);
+}
+
+ServerConfig& SocketManager::getTimeoutServer(ClientState& client) {
+	if (client.assignedConfig)
+		return client.serverConfig;
+	std::string hostName;
+	return getCurrentServer(hostName, client.serverPort);
+}
+
+void SocketManager::watchWrite(int fd, bool enable) {
+#ifdef WEBSERV_HAS_IO_URING
+	if (this->ring) {
+		if (enable)
+			submitSend(fd);
+		return;
 	}
+#endif
+	int events = this->clientStates[fd].readPaused ? 0 : POLLER_READ;
+	this->poller->modify(fd, enable ? events | POLLER_WRITE : events);
 }
 
 bool SocketManager::isServerSocket(int fd) {
-	return std::find(this->server_fds.begin(), this->server_fds.end(), fd) != this->server_fds.end();
+	return fd >= 0 && static_cast<size_t>(fd) < this->listenPorts.size() && this->listenPorts[fd] != 0;
 }
@@ -0,0 +1,163 @@
+#include "TimerWheel.hpp"
+
+TimerWheel::TimerWheel() : armedCount(0) {
+	for (int level = 0; level < TIMER_LEVELS; level++) {
+		for (int slot = 0; slot < TIMER_SLOTS; slot++)
+			this->slots[level][slot] = -1;
+	}
+	updateClock();
+	this->currentTick = this->currentTime / TIMER_TICK;
+}
+
+TimerWheel::~TimerWheel() {}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Clock                                   */
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::updateClock() {
+	struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	this->currentTime = static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t TimerWheel::now() const {
+	return this->currentTime;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Timers                                   */
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::schedule(int fd, uint64_t deadline) {
+	if (fd < 0)
+		return;
+	if (static_cast<size_t>(fd) >= this->timers.size())
+		this->timers.resize(fd + 1);
+	Timer& timer = this->timers[fd];
+	if (timer.armed)
+		unlink(fd);
+	else
+		this->armedCount++;
+	timer.armed = true;
+	// Ticks up to `currentTick` were already processed, so the earliest slot is the next one
+	uint64_t earliest = (this->currentTick + 1) * TIMER_TICK;
+	timer.deadline = deadline < earliest ? earliest : deadline;
+	place(fd);
+}
+
+void TimerWheel::cancel(int fd) {
+	if (fd < 0 || static_cast<size_t>(fd) >= this->timers.size() || !this->timers[fd].armed)
+		return;
+	unlink(fd);
+	this->timers[fd].armed = false;
+	this->armedCount--;
+}
+
+void TimerWheel::place(int fd) {
+	Timer& timer = this->timers[fd];
+	uint64_t tick = (timer.deadline + TIMER_TICK - 1) / TIMER_TICK;
+	if (tick < this->currentTick)
+		tick = this->currentTick;
+	uint64_t delta = tick - this->currentTick;
+	int level = 0;
+	while (level < TIMER_LEVELS - 1 && delta >= static_cast<uint64_t>(1) << (TIMER_SLOT_BITS * (level + 1)))
+		level++;
+	// Deadlines beyond the last wheel wait in its furthest slot and are placed again from there
+	uint64_t range = static_cast<uint64_t>(1) << (TIMER_SLOT_BITS * TIMER_LEVELS);
+	if (delta >= range)
+		tick = this->currentTick + range - 1;
+	timer.level = level;
+	timer.slot = (tick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1);
+	timer.prev = -1;
+	timer.next = this->slots[level][timer.slot];
+	if (timer.next >= 0)
+		this->timers[timer.next].prev = fd;
+	this->slots[level][timer.slot] = fd;
+}
+
+void TimerWheel::unlink(int fd) {
+	Timer& timer = this->timers[fd];
+	if (timer.prev >= 0)
+		this->timers[timer.prev].next = timer.next;
+	else
+		this->slots[timer.level][timer.slot] = timer.next;
+	if (timer.next >= 0)
+		this->timers[timer.next].prev = timer.prev;
+	timer.prev = -1;
+	timer.next = -1;
+}
+
+void TimerWheel::cascade(int level, int slot) {
+	int fd = this->slots[level][slot];
+	this->slots[level][slot] = -1;
+	while (fd >= 0) {
+		int next = this->timers[fd].next;
+		place(fd);
+		fd = next;
+	}
+}
+
+void TimerWheel::expire(std::vector<int>& expired) {
+	expired.clear();
+	uint64_t target = this->currentTime / TIMER_TICK;
+	while (this->currentTick < target) {
+		if (this->armedCount == 0) {
+			this->currentTick = target;
+			break;
+		}
+		uint64_t tick = ++this->currentTick;
+		// Refill the finer wheels from the coarser ones whenever their index wraps around
+		int top = 0;
+		while (top < TIMER_LEVELS - 1 && (tick & ((static_cast<uint64_t>(1) << (TIMER_SLOT_BITS * (top + 1))) - 1)) == 0)
+			top++;
+		for (int level = top; level > 0; level--)
+			cascade(level, (tick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1));
+		int slot = tick & (TIMER_SLOTS - 1);
+		int fd = this->slots[0][slot];
+		this->slots[0][slot] = -1;
+		while (fd >= 0) {
+			Timer& timer = this->timers[fd];
+			int next = timer.next;
+			if ((timer.deadline + TIMER_TICK - 1) / TIMER_TICK <= tick) {
+				timer.prev = -1;
+				timer.next = -1;
+				timer.armed = false;
+				this->armedCount--;
+				expired.push_back(fd);
+			} else {
+				place(fd);
+			}
+			fd = next;
+		}
+	}
+}
+
+int TimerWheel::nextTimeout(int maxTimeout) const {
+	if (this->armedCount == 0)
+		return maxTimeout;
+	uint64_t wake = 0;
+	for (int level = 0; level < TIMER_LEVELS; level++) {
+		uint64_t base = this->currentTick >> (TIMER_SLOT_BITS * level);
+		for (uint64_t i = 1; i <= TIMER_SLOTS; i++) {
+			if (this->slots[level][(base + i) & (TIMER_SLOTS - 1)] < 0)
+				continue;
+			// Timers on a coarse wheel are not due before their slot is cascaded
+			uint64_t tick = (base + i) << (TIMER_SLOT_BITS * level);
+			if (wake == 0 || tick < wake)
+				wake = tick;
+			break;
+		}
+	}
+	uint64_t wakeTime = wake * TIMER_TICK;
+	if (wakeTime <= this->currentTime)
+		return 0;
+	uint64_t timeout = wakeTime - this->currentTime;
+	if (maxTimeout >= 0 && timeout > static_cast<uint64_t>(maxTimeout))
+		return maxTimeout;
+	return static_cast<int>(timeout);
+}
\ No newline at end of file
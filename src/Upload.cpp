@@ -0,0 +1,126 @@
+#include "Upload.hpp"
+#include "Logger.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+
+Upload::Upload(const std::string& rootDirectory, const std::string& uri, const std::string& contentType) :
+	rootDirectory(rootDirectory),
+	uri(uri),
+	multipart(NULL),
+	status(201)
+{
+	if (contentType.find("multipart/form-data") == std::string::npos) {
+		openFile(uri);
+		return;
+	}
+	std::string boundary = MultipartParser::extractBoundary(contentType);
+	if (boundary.empty()) {
+		ERROR("Could not find boundry for multipart/form-data");
+		fail(400);
+		return;
+	}
+	this->multipart = new MultipartParser(boundary, *this);
+}
+
+Upload::~Upload() {
+	delete this->multipart;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Receiving                                 */
+/* -------------------------------------------------------------------------- */
+
+void Upload::write(const char* data, size_t length) {
+	if (this->multipart)
+		this->multipart->feed(data, length);
+	else if (this->file.isOpen())
+		this->file.write(data, length);
+}
+
+void Upload::beginPart(const MultipartPart& part) {
+	// Form fields are not stored, and a file name must not leave the target directory
+	if (part.fileName.empty())
+		return;
+	openFile(this->uri + part.fileName.substr(part.fileName.find_last_of("/\\") + 1));
+}
+
+void Upload::partData(const char* data, size_t length) {
+	if (this->file.isOpen())
+		this->file.write(data, length);
+}
+
+void Upload::endPart() {
+	commitFile();
+}
+
+void Upload::finish() {
+	if (this->multipart && !this->multipart->done()) {
+		ERROR("Incomplete or malformed multipart/form-data body");
+		this->file.abort();
+		fail(400);
+		return;
+	}
+	commitFile();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Files                                   */
+/* -------------------------------------------------------------------------- */
+
+void Upload::openFile(const std::string& fileUri) {
+	if (this->status != 201)
+		return;
+	std::string savePath = this->rootDirectory + fileUri;
+	if (access(savePath.c_str(), F_OK) != -1) {
+		WARNING("File already exists: " + savePath);
+		this->location = fileUri;
+		fail(302);
+		return;
+	}
+	if (!this->file.open(savePath)) {
+		ERROR("Unable to open file for writing: " + savePath);
+		fail(500);
+		return;
+	}
+	this->fileUri = fileUri;
+}
+
+void Upload::commitFile() {
+	if (!this->file.isOpen())
+		return;
+	std::string savePath = this->rootDirectory + this->fileUri;
+	int error = this->file.commit();
+	if (error == EEXIST) {
+		WARNING("File already exists: " + savePath);
+		this->location = this->fileUri;
+		fail(302);
+	} else if (error != 0) {
+		ERROR("Failed to store file");
+		fail(500);
+	} else {
+		INFO("File uploaded successfully: " + savePath);
+		this->savedPaths.push_back(savePath);
+	}
+}
+
+void Upload::fail(int status) {
+	if (this->status == 201)
+		this->status = status;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Getter Functions                              */
+/* -------------------------------------------------------------------------- */
+
+int Upload::getStatus() const {
+	return this->status;
+}
+
+const std::vector<std::string>& Upload::getSavedPaths() const {
+	return this->savedPaths;
+}
+
+const std::string& Upload::getLocation() const {
+	return this->location;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "WorkerProcesses.hpp"
+
+WorkerProcesses::WorkerProcesses(const HTTPConfig& config): config(config), socketManager(config), lastReport(0) {}
+
+WorkerProcesses::~WorkerProcesses() {}
+
+void WorkerProcesses::run() {
+	this->socketManager.setupServerSockets();
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &signals, NULL);
+	INFO("Master process " << getpid() << " starting " << this->config.workerProcesses << " worker processes");
+	this->workers.resize(this->config.workerProcesses);
+	for (size_t i = 0; i < this->workers.size(); i++)
+		spawnWorker(i, signals);
+	time(&this->lastReport);
+	struct timespec timeout = {1, 0};
+	while (true) {
+		int sig = sigtimedwait(&signals, NULL, &timeout);
+		if (sig == SIGINT || sig == SIGTERM) {
+			INFO("Master received signal " << sig << ", stopping worker processes");
+			break;
+		}
+		reapWorkers();
+		respawnWorkers(signals);
+		time_t now;
+		time(&now);
+		if (difftime(now, this->lastReport) >= WORKER_REPORT_INTERVAL)
+			reportLiveness();
+	}
+	stopWorkers();
+	sigprocmask(SIG_UNBLOCK, &signals, NULL);
+}
+
+void WorkerProcesses::spawnWorker(size_t index, sigset_t& signals) {
+	pid_t pid = fork();
+	if (pid < 0) {
+		ERROR("Failed to fork worker " << index << ", retrying later");
+		this->workers[index].respawnAt = time(NULL) + WORKER_RESPAWN_DELAY;
+		return;
+	}
+	if (pid == 0) {
+#ifdef __linux__
+		prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+		sigprocmask(SIG_UNBLOCK, &signals, NULL);
+		INFO("Worker " << index << " running as process " << getpid());
+		try {
+			this->socketManager.run();
+		} catch (const std::exception& e) {
+			ERROR("Worker " << index << ": " << e.what());
+			_exit(1);
+		}
+		_exit(0);
+	}
+	this->workers[index].pid = pid;
+	this->workers[index].startedAt = time(NULL);
+	this->workers[index].respawnAt = 0;
+}
+
+void WorkerProcesses::reapWorkers() {
+	int status;
+	pid_t pid;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		for (size_t i = 0; i < this->workers.size(); i++) {
+			if (this->workers[i].pid != pid)
+				continue;
+			if (WIFSIGNALED(status)) {
+				ERROR("Worker " << i << " (process " << pid << ") was killed by signal " << WTERMSIG(status));
+			} else {
+				WARNING("Worker " << i << " (process " << pid << ") exited with status " << WEXITSTATUS(status));
+			}
+			time_t now = time(NULL);
+			this->workers[i].pid = -1;
+			this->workers[i].respawnAt = difftime(now, this->workers[i].startedAt) < WORKER_RESPAWN_DELAY ? now + WORKER_RESPAWN_DELAY : now;
+			break;
+		}
+	}
+}
+
+void WorkerProcesses::respawnWorkers(sigset_t& signals) {
+	time_t now = time(NULL);
+	for (size_t i = 0; i < this->workers.size(); i++) {
+		if (this->workers[i].pid == -1 && now >= this->workers[i].respawnAt) {
+			this->workers[i].restarts++;
+			spawnWorker(i, signals);
+			if (this->workers[i].pid != -1)
+				WARNING("Respawned worker " << i << " as process " << this->workers[i].pid);
+		}
+	}
+}
+
+void WorkerProcesses::reportLiveness() {
+	time_t now = time(NULL);
+	this->lastReport = now;
+	for (size_t i = 0; i < this->workers.size(); i++) {
+		const WorkerProcess& worker = this->workers[i];
+		if (worker.pid != -1 && kill(worker.pid, 0) == 0) {
+			INFO("Worker " << i << ": process " << worker.pid << " alive, up " << difftime(now, worker.startedAt) << "s, restarted " << worker.restarts << " times");
+		} else {
+			WARNING("Worker " << i << ": down, restarted " << worker.restarts << " times");
+		}
+	}
+}
+
+void WorkerProcesses::stopWorkers() {
+	for (size_t i = 0; i < this->workers.size(); i++) {
+		if (this->workers[i].pid != -1)
+			kill(this->workers[i].pid, SIGTERM);
+	}
+	time_t deadline = time(NULL) + WORKER_SHUTDOWN_TIMEOUT;
+	for (size_t i = 0; i < this->workers.size(); i++) {
+		if (this->workers[i].pid == -1)
+			continue;
+		while (waitpid(this->workers[i].pid, NULL, WNOHANG) == 0) {
+			if (time(NULL) >= deadline) {
+				WARNING("Worker " << i << " did not stop in time, killing it");
+				kill(this->workers[i].pid, SIGKILL);
+				waitpid(this->workers[i].pid, NULL, 0);
+				break;
+			}
+			usleep(10000);
+		}
+		this->workers[i].pid = -1;
+	}
+}
\ No newline at end of file
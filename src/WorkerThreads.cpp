@@ -0,0 +1,90 @@
+#include "WorkerThreads.hpp"
+
+struct WorkerArgs {
+	WorkerThreads* workers;
+	SocketManager* manager;
+	int index;
+};
+
+WorkerThreads::WorkerThreads(const HTTPConfig& config): config(config), running(0) {
+	pthread_mutex_init(&this->runningMutex, NULL);
+}
+
+WorkerThreads::~WorkerThreads() {
+	for (size_t i = 0; i < this->managers.size(); i++)
+		delete this->managers[i];
+	pthread_mutex_destroy(&this->runningMutex);
+}
+
+void* WorkerThreads::workerMain(void* arg) {
+	WorkerArgs* args = static_cast<WorkerArgs*>(arg);
+	INFO("Worker thread " << args->index << " started");
+	try {
+		args->manager->setupServerSockets();
+		args->manager->run();
+	} catch (const std::exception& e) {
+		ERROR("Worker thread " << args->index << ": " << e.what());
+	}
+	INFO("Worker thread " << args->index << " stopped");
+	pthread_mutex_lock(&args->workers->runningMutex);
+	args->workers->running--;
+	pthread_mutex_unlock(&args->workers->runningMutex);
+	delete args;
+	return NULL;
+}
+
+void WorkerThreads::run() {
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	g_run = true;
+	INFO("Starting " << this->config.workerThreads << " worker threads");
+	for (int i = 0; i < this->config.workerThreads; i++) {
+		SocketManager* manager = new SocketManager(this->config);
+		this->managers.push_back(manager);
+		WorkerArgs* args = new WorkerArgs();
+		args->workers = this;
+		args->manager = manager;
+		args->index = i;
+		pthread_t thread;
+		pthread_mutex_lock(&this->runningMutex);
+		this->running++;
+		pthread_mutex_unlock(&this->runningMutex);
+		if (pthread_create(&thread, NULL, workerMain, args) != 0) {
+			ERROR("Failed to create worker thread " << i);
+			pthread_mutex_lock(&this->runningMutex);
+			this->running--;
+			pthread_mutex_unlock(&this->runningMutex);
+			delete args;
+			continue;
+		}
+		this->threads.push_back(thread);
+	}
+	waitForShutdown(signals);
+	g_run = false;
+	for (size_t i = 0; i < this->managers.size(); i++)
+		this->managers[i]->wakeup();
+	for (size_t i = 0; i < this->threads.size(); i++)
+		pthread_join(this->threads[i], NULL);
+	pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+}
+
+void WorkerThreads::waitForShutdown(sigset_t& signals) {
+	struct timespec timeout = {1, 0};
+	while (true) {
+		int sig = sigtimedwait(&signals, NULL, &timeout);
+		if (sig == SIGINT || sig == SIGTERM) {
+			INFO("Received signal " << sig << ", stopping worker threads");
+			return;
+		}
+		pthread_mutex_lock(&this->runningMutex);
+		int stillRunning = this->running;
+		pthread_mutex_unlock(&this->runningMutex);
+		if (stillRunning == 0) {
+			WARNING("All worker threads stopped");
+			return;
+		}
+	}
+}
\ No newline at end of file
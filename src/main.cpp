@@ -1,6 +1,9 @@
 #include "ConfigManager.hpp"
 #include "SocketManager.hpp"
+#include "WorkerThreads.hpp"
+#include "WorkerProcesses.hpp"
 #include "Logger.hpp"
+#include "Scan.hpp"
 #include <stdexcept>
 
 int main(int argc, char** argv) {
@@ -18,9 +21,19 @@ int main(int argc, char** argv) {
 			configManager.parseConfigFile("config/default.config");
 		else
 			configManager.parseConfigFile(argv[1]);
-		SocketManager socketManager(configManager.getConfig());
-		socketManager.setupServerSockets();
-		socketManager.run();
+		// Selects the scanning kernels before any worker thread can race on the first call
+		INFO("Using " << Scan::variant() << " scanning kernels");
+		if (configManager.getConfig().workerProcesses > 1) {
+			WorkerProcesses workerProcesses(configManager.getConfig());
+			workerProcesses.run();
+		} else if (configManager.getConfig().workerThreads > 1) {
+			WorkerThreads workerThreads(configManager.getConfig());
+			workerThreads.run();
+		} else {
+			SocketManager socketManager(configManager.getConfig());
+			socketManager.setupServerSockets();
+			socketManager.run();
+		}
 	} catch (const std::runtime_error& e) {
 		ERROR(e.what());
 	}
@@ -53,6 +53,53 @@ bool endsWith(const std::string& fullString, const std::string& ending) {
 	return fullString.compare(fullString.length() - ending.length(), ending.length(), ending) == 0;
 }
 
+std::string getQueryParameter(const std::string& query, const std::string& name) {
+	size_t start = 0;
+	while (start <= query.size()) {
+		size_t end = query.find('&', start);
+		if (end == std::string::npos)
+			end = query.size();
+		if (query.compare(start, name.size(), name) == 0 && start + name.size() < end && query[start + name.size()] == '=')
+			return query.substr(start + name.size() + 1, end - start - name.size() - 1);
+		start = end + 1;
+	}
+	return "";
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 HTTP dates                                 */
+/* -------------------------------------------------------------------------- */
+
+std::string formatHTTPDate(time_t time) {
+	struct tm date;
+	char buffer[64];
+	gmtime_r(&time, &date);
+	strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &date);
+	return buffer;
+}
+
+const char* currentHTTPDate() {
+	static __thread time_t formattedTime = -1;
+	static __thread char formatted[32];
+	time_t now = time(NULL);
+	if (now != formattedTime) {
+		struct tm date;
+		gmtime_r(&now, &date);
+		strftime(formatted, sizeof(formatted), "%a, %d %b %Y %H:%M:%S GMT", &date);
+		formattedTime = now;
+	}
+	return formatted;
+}
+
+time_t parseHTTPDate(const std::string& str) {
+	struct tm date;
+	std::memset(&date, 0, sizeof(date));
+	const char* end = strptime(str.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &date);
+	if (end == NULL || *end != '\0')
+		return -1;
+	return timegm(&date);
+}
+
 /* -------------------------------------------------------------------------- */
 /*                              Enum conversions                              */
 /* -------------------------------------------------------------------------- */
@@ -62,6 +109,7 @@ std::string requestTypeToString(RequestTypes type) {
 		case GET: return "GET";
 		case POST: return "POST";
 		case DELETE: return "DELETE";
+		case HEAD: return "HEAD";
 		default: return "Unknown";
 	}
 }
@@ -70,6 +118,7 @@ RequestTypes stringToRequestType(const std::string& str) {
 	if (str == "GET") return GET;
 	if (str == "DELETE") return DELETE;
 	if (str == "POST") return POST;
+	if (str == "HEAD") return HEAD;
 	throw std::runtime_error("Unsupported request type: " + str);
 }
 